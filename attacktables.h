@@ -0,0 +1,63 @@
+#ifndef ATTACKTABLES_H
+#define ATTACKTABLES_H
+
+#include <QtGlobal>
+
+// attack and line tables for every square, generated at compile time
+// squares are numbered 0..63, `row * 8 + col`, as in `BoardPosition`
+struct AttackTables
+{
+    typedef quint64 Bitboard;
+
+    Bitboard knightAttacks[64];
+    Bitboard kingAttacks[64];
+    // squares a pawn captures on, indexed by `Piece::PieceColour`, White moving towards row 7
+    Bitboard pawnAttacks[2][64];
+    // all the squares on the same row or column (straightLines), or on the same diagonals (diagonalLines)
+    Bitboard straightLines[64];
+    Bitboard diagonalLines[64];
+    // the squares strictly between two squares which share a row, column or diagonal, else 0
+    Bitboard between[64][64];
+
+    constexpr AttackTables() :
+        knightAttacks{}, kingAttacks{}, pawnAttacks{}, straightLines{}, diagonalLines{}, between{}
+    {
+        constexpr int knightDeltas[8][2] = { {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2} };
+        constexpr int lineDeltas[8][2] = { {0, 1}, {0, -1}, {1, 0}, {-1, 0}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1} };
+        for (int row = 0; row < 8; row++)
+            for (int col = 0; col < 8; col++)
+            {
+                int square = row * 8 + col;
+                for (const auto &delta : knightDeltas)
+                    knightAttacks[square] |= squareBit(row + delta[0], col + delta[1]);
+                for (const auto &delta : lineDeltas)
+                    kingAttacks[square] |= squareBit(row + delta[0], col + delta[1]);
+                pawnAttacks[0][square] = squareBit(row + 1, col - 1) | squareBit(row + 1, col + 1);
+                pawnAttacks[1][square] = squareBit(row - 1, col - 1) | squareBit(row - 1, col + 1);
+                // walk out along each line, everything passed so far is between `square` and the square reached
+                for (int i = 0; i < 8; i++)
+                {
+                    Bitboard passed = 0;
+                    for (int r = row + lineDeltas[i][0], c = col + lineDeltas[i][1]; r >= 0 && r < 8 && c >= 0 && c < 8; r += lineDeltas[i][0], c += lineDeltas[i][1])
+                    {
+                        between[square][r * 8 + c] = passed;
+                        passed |= squareBit(r, c);
+                        if (i < 4)
+                            straightLines[square] |= squareBit(r, c);
+                        else
+                            diagonalLines[square] |= squareBit(r, c);
+                    }
+                }
+            }
+    }
+
+private:
+    static constexpr Bitboard squareBit(int row, int col)
+    {
+        return (row >= 0 && row < 8 && col >= 0 && col < 8) ? Bitboard(1) << (row * 8 + col) : 0;
+    }
+};
+
+inline constexpr AttackTables attackTables;
+
+#endif // ATTACKTABLES_H
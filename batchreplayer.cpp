@@ -0,0 +1,97 @@
+#include <QAtomicInt>
+#include <QFile>
+#include <QFuture>
+#include <QMutex>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include "batchreplayer.h"
+
+BatchReplayer::BatchReplayer(int threadCount /*= 0*/)
+{
+    // `threadCount` is the number of worker threads to use, 0 => one per core
+    _threadCount = (threadCount > 0) ? threadCount : QThread::idealThreadCount();
+    _moveParseCacheSize = 0;
+}
+
+/*static*/ QList<BatchReplayer::Game> BatchReplayer::indexGames(const QStringList &filePaths)
+{
+    // return all the games in the files at `filePaths`, in file order and then game order within each file
+    // a file which cannot be indexed is still returned as one game, so that replaying it reports why it cannot be read
+    QList<Game> games;
+    for (const QString &filePath : filePaths)
+    {
+        GameIndex gameIndex;
+        if (!gameIndex.open(filePath))
+        {
+            games.append({ filePath });
+            continue;
+        }
+        for (int i = 0; i < gameIndex.count(); i++)
+            games.append({ filePath, (gameIndex.count() > 1) ? i + 1 : 0, gameIndex.at(i) });
+    }
+    return games;
+}
+
+QVector<GameReplayer::Result> BatchReplayer::replay(const QList<Game> &games, MoveParseCache::Stats *cacheStats /*= nullptr*/) const
+{
+    // replay all of `games`, in parallel across the worker threads
+    // return the results in the same order as `games`
+    // if `cacheStats` is passed it is set to the move parse caches' hits/misses, summed over the workers
+    QVector<GameReplayer::Result> results(games.count());
+    // each result is written by exactly one worker, into its own (already allocated) element
+    GameReplayer::Result *resultData = results.data();
+
+    // each worker repeatedly takes the next chunk of games, till there are none left
+    // so a worker which gets short games simply takes more chunks
+    QAtomicInt nextChunk(0);
+    QMutex statsMutex;
+    MoveParseCache::Stats totalStats;
+    int cacheSize = _moveParseCacheSize;
+    auto worker = [&games, resultData, &nextChunk, &statsMutex, &totalStats, cacheSize]()
+    {
+        GameReplayer replayer;
+        MoveParseCache cache(qMax(cacheSize, 1));
+        if (cacheSize > 0)
+            replayer.setMoveParseCache(&cache);
+        QFile file;
+        for (;;)
+        {
+            int first = nextChunk.fetchAndAddRelaxed(1) * GamesPerChunk;
+            if (first >= games.count())
+                break;
+            int last = qMin(first + GamesPerChunk, games.count());
+            for (int i = first; i < last; i++)
+            {
+                const Game &game(games.at(i));
+                // consecutive games are usually from the same file, so keep it open
+                if (file.fileName() != game.filePath || !file.isOpen())
+                {
+                    file.close();
+                    file.setFileName(game.filePath);
+                    if (!file.open(QIODevice::ReadOnly))
+                    {
+                        resultData[i].message = QString("%1: %2").arg(file.fileName()).arg(file.errorString());
+                        continue;
+                    }
+                }
+                file.seek(game.entry.pos);
+                resultData[i] = replayer.replay(&file, game.entry.endPos);
+            }
+        }
+        QMutexLocker locker(&statsMutex);
+        totalStats += cache.stats();
+    };
+
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(_threadCount);
+    QList<QFuture<void>> futures;
+    for (int i = 0; i < _threadCount; i++)
+        futures.append(QtConcurrent::run(&threadPool, worker));
+    for (QFuture<void> &future : futures)
+        future.waitForFinished();
+    if (cacheStats)
+        *cacheStats = totalStats;
+    return results;
+}
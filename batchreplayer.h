@@ -0,0 +1,41 @@
+#ifndef BATCHREPLAYER_H
+#define BATCHREPLAYER_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "gameindex.h"
+#include "gamereplayer.h"
+#include "moveparsecache.h"
+
+// replays many games in parallel, to validate a whole collection
+// each worker thread has its own `GameReplayer` (and so its own `BoardModel`), nothing is shared between them
+// optionally each worker also has its own `MoveParseCache`, so moves shared by its games (e.g. openings) are resolved once
+class BatchReplayer
+{
+public:
+    BatchReplayer(int threadCount = 0);
+
+    struct Game
+    {
+        QString filePath;
+        int gameNumber = 0;     // 1-based number of the game in a multi-game file, 0 => the file holds one game
+        GameIndex::Entry entry{ 0, -1 };
+    };
+
+    static QList<Game> indexGames(const QStringList &filePaths);
+    QVector<GameReplayer::Result> replay(const QList<Game> &games, MoveParseCache::Stats *cacheStats = nullptr) const;
+    inline int threadCount() const { return _threadCount; }
+    inline int moveParseCacheSize() const { return _moveParseCacheSize; }
+    inline void setMoveParseCacheSize(int entries) { _moveParseCacheSize = entries; }
+
+private:
+    // games are handed out to worker threads this many at a time
+    enum { GamesPerChunk = 16 };
+    int _threadCount;
+    int _moveParseCacheSize;    // 0 => no move parse cache
+};
+
+#endif // BATCHREPLAYER_H
@@ -0,0 +1,205 @@
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRegularExpression>
+#include <QTextStream>
+
+#include "boardmodel.h"
+#include "gameindex.h"
+#include "gamereplayer.h"
+#include "movegenerator.h"
+
+static QStringList readTokensOriginal(const QString &fileContent)
+{
+    // the game file reader as it originally was, reading the whole file, splitting it and constructing (and so compiling)
+    // a regular expression on every use, kept only as a historical reference to compare `GameReplayer::readTokens()` with
+    QStringList tokens = fileContent.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
+    for (int i = 0; i < tokens.count(); i++)
+        if (i % 2 == 0 && tokens.at(i).contains(QRegularExpression("^\\d+\\.?$")))
+            tokens.removeAt(i--);
+    return tokens;
+}
+
+static double nsPer(qint64 nsecs, qint64 count)
+{
+    return count > 0 ? double(nsecs) / count : 0.0;
+}
+
+// results of benchmarked operations are accumulated here, so that the compiler cannot optimize the operations away
+static volatile qint64 benchmarkSink;
+
+template<typename Operation>
+static void runBenchmark(QTextStream &out, const QString &name, Operation operation)
+{
+    // time `operation`, which does one operation per call and returns a result for `benchmarkSink`, in the style of Google Benchmark
+    // the number of iterations is doubled till they take at least `minNsecs`, then the time per iteration is reported
+    constexpr qint64 minNsecs = 200000000;
+    QElapsedTimer timer;
+    qint64 iterations = 1, nsecs;
+    for (;;)
+    {
+        qint64 sink = 0;
+        timer.start();
+        for (qint64 i = 0; i < iterations; i++)
+            sink += operation();
+        nsecs = timer.nsecsElapsed();
+        benchmarkSink = benchmarkSink + sink;
+        if (nsecs >= minNsecs || iterations >= (qint64(1) << 40))
+            break;
+        iterations *= 2;
+    }
+    out << QString("%1 %2 ns/op %3 iterations").arg(name, -40).arg(nsPer(nsecs, iterations), 10, 'f', 1).arg(iterations, 12) << Qt::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    // console program to micro-benchmark the move parser and the game file reader
+    // usage: chessbench [file-or-directory]... [-r repetitions]
+    // with no files the `samplegames` directory is used
+    // finally the core board model operations are each timed on a middle game position
+    QCoreApplication a(argc, argv);
+    QTextStream out(stdout), err(stderr);
+
+    QStringList args = QCoreApplication::arguments().mid(1);
+    int repetitions = 20;
+    int repetitionsIndex = args.indexOf("-r");
+    if (repetitionsIndex >= 0 && repetitionsIndex + 1 < args.count())
+    {
+        repetitions = qMax(1, args.at(repetitionsIndex + 1).toInt());
+        args.removeAt(repetitionsIndex + 1);
+        args.removeAt(repetitionsIndex);
+    }
+    if (args.isEmpty())
+        args << "samplegames";
+
+    // read every game file's content once, so that file i/o is not measured
+    QList<QByteArray> fileContents;
+    for (const QString &filePath : GameIndex::expandFilePaths(args))
+    {
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            err << filePath << ": " << file.errorString() << Qt::endl;
+            return 1;
+        }
+        fileContents << file.readAll();
+    }
+    if (fileContents.isEmpty())
+    {
+        err << "Usage: chessbench [file-or-directory]... [-r repetitions]" << Qt::endl;
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    qint64 tokenCount = 0, nsecs;
+
+    // game file reader: splitting into tokens and removing turn numbers
+    timer.start();
+    for (int r = 0; r < repetitions; r++)
+        for (const QByteArray &fileContent : fileContents)
+            tokenCount += readTokensOriginal(QString::fromUtf8(fileContent)).count();
+    nsecs = timer.nsecsElapsed();
+    out << QString("readTokens(), original (reference):     %1 ns/token").arg(nsPer(nsecs, tokenCount), 10, 'f', 1) << Qt::endl;
+
+    tokenCount = 0;
+    QList<QStringList> games;
+    timer.start();
+    for (int r = 0; r < repetitions; r++)
+        for (QByteArray fileContent : fileContents)
+        {
+            QBuffer buffer(&fileContent);
+            buffer.open(QIODevice::ReadOnly);
+            QStringList tokens = GameReplayer::readTokens(&buffer);
+            tokenCount += tokens.count();
+            if (r == 0)
+                games << tokens;
+        }
+    nsecs = timer.nsecsElapsed();
+    out << QString("readTokens(), streaming:                %1 ns/token").arg(nsPer(nsecs, tokenCount), 10, 'f', 1) << Qt::endl;
+
+    // the whole of `MoveParser::parse()`, on the actual position before each move of each game
+    BoardModel boardModel;
+    QList<MoveParser::ParsedMove> moves;
+    qint64 moveCount = 0;
+    nsecs = 0;
+    for (const QStringList &tokens : games)
+    {
+        boardModel.newGame();
+        Piece::PieceColour player = Piece::White;
+        for (const QString &token : tokens)
+        {
+            MoveParser moveParser(&boardModel.position(), player);
+            timer.start();
+            for (int r = 0; r < repetitions; r++)
+                moveParser.parse(token, moves);
+            nsecs += timer.nsecsElapsed();
+            moveCount += repetitions;
+            if (!boardModel.replayMove(player, token))
+                break;
+            player = Piece::opposingColour(player);
+        }
+    }
+    out << QString("MoveParser::parse():                    %1 ns/move").arg(nsPer(nsecs, moveCount), 10, 'f', 1) << Qt::endl;
+
+    // individual board model operations, each on a middle game position: the first game played halfway through
+    // the moves are made through `parseAndMakeMove()`, so that the move history (and hence the player to move) is kept
+    out << Qt::endl;
+    boardModel.newGame();
+    const QStringList &benchmarkTokens(games.first());
+    Piece::PieceColour player = Piece::White;
+    for (int i = 0; i < benchmarkTokens.count() / 2; i++)
+    {
+        if (!boardModel.parseAndMakeMove(player, benchmarkTokens.at(i)))
+            break;
+        player = Piece::opposingColour(player);
+    }
+    const QString nextToken = boardModel.moveHistoryModel()->moveCount() < benchmarkTokens.count()
+            ? benchmarkTokens.at(boardModel.moveHistoryModel()->moveCount()) : QString("P-K4");
+
+    // every (from, to) pair from an occupied square, taken in turn
+    QList<BoardModel::BoardSquareFromTo> fromTos;
+    for (int from = 0; from < 64; from++)
+        if (boardModel.position().isOccupied(from))
+            for (int to = 0; to < 64; to++)
+                fromTos.append({ BoardModel::BoardSquare(BoardPosition::rowOf(from), BoardPosition::colOf(from)),
+                                 BoardModel::BoardSquare(BoardPosition::rowOf(to), BoardPosition::colOf(to)) });
+    int fromToIndex = 0;
+    runBenchmark(out, "BM_CouldMoveFromTo", [&]() {
+        const BoardModel::BoardSquareFromTo &fromTo(fromTos.at(fromToIndex));
+        fromToIndex = (fromToIndex + 1) % fromTos.count();
+        return boardModel.couldMoveFromTo(fromTo.from, fromTo.to, boardModel.pieceAt(fromTo.to).has_value());
+    });
+
+    runBenchmark(out, "BM_CheckForCheck", [&]() {
+        BoardModel::BoardSquare from, to;
+        return boardModel.checkForCheck(from, to);
+    });
+
+    int pieceIndex = 0;
+    runBenchmark(out, "BM_FindPieces", [&]() {
+        Piece::PieceColour colour = static_cast<Piece::PieceColour>(pieceIndex / 6);
+        Piece::PieceName name = static_cast<Piece::PieceName>(pieceIndex % 6);
+        pieceIndex = (pieceIndex + 1) % 12;
+        int count = 0;
+        for (const BoardModel::BoardSquare &square : boardModel.findPieces(colour, name))
+            count += square.row;
+        return count;
+    });
+
+    MoveParser benchmarkParser(&boardModel.position(), player);
+    runBenchmark(out, "BM_MoveParserParse", [&]() {
+        return benchmarkParser.parse(nextToken, moves);
+    });
+
+    GameState benchmarkState;
+    benchmarkState.board = boardModel.position();
+    benchmarkState.playerToMove = player;
+    runBenchmark(out, "BM_GenerateLegalMoves", [&]() {
+        MoveList legalMoves;
+        MoveGenerator::generateLegalMoves(benchmarkState, legalMoves);
+        return legalMoves.count();
+    });
+
+    return 0;
+}
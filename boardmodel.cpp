@@ -1,201 +1,39 @@
+#include <algorithm>
+
+#include <QAction>
 #include <QDebug>
-#include <QRegularExpression>
 #include <QString>
+#include <QStringList>
 
 #include "boardmodel.h"
+#include "movegenerator.h"
+#include "moveparsecache.h"
 
 BoardModel::BoardModel(QObject *parent) :
     QObject(parent)
 {
     _moveHistoryModel = new MoveHistoryModel(this);
     modelBeingReset = false;
-    clearBoardPieces(true);
-
-    connect(&undoMovesStack, &QUndoStack::indexChanged, this, &BoardModel::undoStackIndexChanged);
+    moveBatchDepth = 0;
+    _moveParseCache = nullptr;
 }
 
 BoardModel::~BoardModel()
 {
-    clearBoardPieces();
-}
-
-QList<BoardModel::BoardSquare> BoardModel::findPieces(Piece::PieceColour colour, Piece::PieceName name) const
-{
-    // return a list of all the squares occupied by a piece of given type & colour
-    QList<BoardSquare> squares;
-    const Piece *piece;
-    for (int row = 0; row < 8; row++)
-        for (int col = 0; col < 8; col++)
-            if ((piece = boardPieces[row][col]))
-                if (piece->colour == colour && piece->name == name)
-                    squares.append({row, col});
-    return squares;
-}
-
-bool BoardModel::obstructedMoveFromTo(const BoardSquare &squareFrom, const BoardSquare &squareTo) const
-{
-    // return whether a piece obstructs a move from `squareFrom` to `squareTo`
-    // move must be either straight or diagonal line
-    // no attempt is made to look at the piece or the move, outside world is expected to do that
-
-    // set distances to (signed) number of squares in col/row direction
-    int colDistance = squareTo.col - squareFrom.col, rowDistance = squareTo.row - squareFrom.row;
-    // ensure it's either straight or diagonal
-    Q_ASSERT(colDistance == 0 || rowDistance == 0 || qAbs(colDistance) == qAbs(rowDistance));
-    int colDelta = (colDistance < 0) ? -1 : (colDistance > 0) ? 1 : 0;
-    int rowDelta = (rowDistance < 0) ? -1 : (rowDistance > 0) ? 1 : 0;
-    // ensure delta is not (0, 0), else we will get stuck!
-    Q_ASSERT(colDelta != 0 || rowDelta != 0);
-    // look at each square between `squareFrom` and `squareTo` (both exclusive) for any piece, which would block move
-    BoardSquare square(squareFrom);
-    square.col += colDelta;
-    square.row += rowDelta;
-    while (square.col != squareTo.col || square.row != squareTo.row)
-    {
-        if (pieceAt(square))
-            return true;
-        square.col += colDelta;
-        square.row += rowDelta;
-    }
-    return false;
 }
 
 bool BoardModel::couldMoveFromTo(const Piece &piece, const BoardSquare &squareFrom, const BoardSquare &squareTo, bool capture, bool enpassant /*= false*/) const
 {
     // return whether the piece specified, if it were in `squareFrom` (which it may or may not be), could move to `squareTo`
     // if `capture` it is a capture (possibly enpassant) move else it is a move move
-
-    // set distances to (signed) number of squares in col/row direction, from player's point of view
-    int colDistance = squareTo.col - squareFrom.col, rowDistance = squareTo.row - squareFrom.row;
-    if (piece.isBlack())
-        rowDistance = -rowDistance;
-    // can't move to square it is presently on
-    if (colDistance == 0 && rowDistance == 0)
-        return false;
-    Piece *squareToPiece = pieceAt(squareTo);
-    if (capture)
-    {
-        // square must be occupied by opposing piece
-        if (!squareToPiece || squareToPiece->colour == piece.colour)
-            return false;
-        // and if it's enpassant both pieces must be a pawn
-        if (enpassant)
-            if (piece.name != Piece::Pawn || squareToPiece->name != Piece::Pawn)
-                return false;
-    }
-    else
-    {
-        // can't move to square occupied by either side
-        if (squareToPiece)
-            return false;
-    }
-
-    switch (piece.name)
-    {
-    case Piece::King: {
-        // kings move one square in any direction
-        // note that we do not allow the special 2-square move for castling here as that is handled specially elsewhere
-        if (qAbs(colDistance) <= 1 && qAbs(rowDistance) <= 1)
-            return true;
-        return false;
-    }
-        break;
-
-    case Piece::Queen: {
-        // queens move like rooks or bishops
-        if (colDistance == 0 || rowDistance == 0 || qAbs(colDistance) == qAbs(rowDistance))
-            if (!obstructedMoveFromTo(squareFrom, squareTo))
-                return true;
-        return false;
-    }
-        break;
-
-    case Piece::Rook: {
-        // rooks move straight
-        // note that we do not allow the special 2/3-square move for castling here as that is handled specially elsewhere
-        if (colDistance == 0 || rowDistance == 0)
-            if (!obstructedMoveFromTo(squareFrom, squareTo))
-                return true;
-        return false;
-    }
-        break;
-
-    case Piece::Bishop: {
-        // bishops move diagonally
-        if (qAbs(colDistance) == qAbs(rowDistance))
-            if (!obstructedMoveFromTo(squareFrom, squareTo))
-                return true;
-        return false;
-    }
-        break;
-
-    case Piece::Knight: {
-        // knights move like knights move :)
-        if ((qAbs(colDistance) == 2 && qAbs(rowDistance) == 1) || (qAbs(colDistance) == 1 && qAbs(rowDistance) == 2))
-            return true;
-        return false;
-    }
-        break;
-
-    case Piece::Pawn: {
-        if (capture)
-        {
-            // pawns move diagonally forward 1 square
-            // must be in adjacent column
-            if (colDistance != -1 && colDistance != 1)
-                return false;
-            if (enpassant)
-            {
-                // check for special enpassant capture
-                // here `squareTo` will be the square *currently* occupied by the opposing pawn
-                // so this will actually look like a "sideways" move to that pawn's square
-                // outside world will then have to deal with adjusting the final position of the capturing pawn
-                Q_ASSERT(squareToPiece->name == Piece::Pawn);
-                // must be "sideways"
-                if (rowDistance != 0)
-                    return false;
-                // captured pawn must be on 4th rank
-                if (squareTo.row != (squareToPiece->isWhite() ? 3 : 4))
-                    return false;
-                // the 2 squares behind the captured pawn must be empty, else this can't be enpassant
-                if (pieceAt(squareToPiece->isWhite() ? 2 : 5, squareTo.col) || pieceAt(squareToPiece->isWhite() ? 1 : 6, squareTo.col))
-                    return false;
-                return true;
-            }
-            else
-            {
-                if (rowDistance == 1)
-                    return true;
-            }
-        }
-        else
-        {
-            // pawns move straight forward 1 or possibly 2 squares
-            // must be in same column
-            if (colDistance != 0)
-                return false;
-            // pawns can move 1 square forward, or 2 if they are on their starting row
-            if (rowDistance == 1)
-                return true;
-            else if (rowDistance == 2)
-            {
-                if (squareFrom.row == (piece.isWhite() ? 1 : 6))
-                    if (!obstructedMoveFromTo(squareFrom, squareTo))
-                        return true;
-            }
-        }
-        return false;
-    }
-        break;
-    }
-    return false;
+    return _position.couldMoveFromTo(piece, BoardPosition::square(squareFrom.row, squareFrom.col), BoardPosition::square(squareTo.row, squareTo.col), capture, enpassant);
 }
 
 bool BoardModel::couldMoveFromTo(const BoardSquare &squareFrom, const BoardSquare &squareTo, bool capture, bool enpassant /*= false*/) const
 {
     // return whether the piece in `squareFrom` could move to `squareTo`
     // if `capture` it is a capture (possibly enpassant) move else it is a move move
-    const Piece *piece = pieceAt(squareFrom);
+    std::optional<Piece> piece = pieceAt(squareFrom);
     Q_ASSERT(piece);
     return couldMoveFromTo(*piece, squareFrom, squareTo, capture, enpassant);
 }
@@ -205,71 +43,61 @@ bool BoardModel::checkForCheck(BoardModel::BoardSquare &from, BoardModel::BoardS
     // see whether the opposing King is in check from any of player's pieces
     // if so, set `from` & `to` to the piece giving check and the opposing King receiving check
     Piece::PieceColour player = _moveHistoryModel->playerToMove();
-    QList<BoardModel::BoardSquare> squaresOpposingKing(findPieces(Piece::opposingColour(player), Piece::King));
-    if (squaresOpposingKing.length() != 1)
+    int kingSquare = _position.kingSquare(Piece::opposingColour(player));
+    if (kingSquare < 0)
         return false;
-    BoardModel::BoardSquare squareTo(squaresOpposingKing.at(0));
-    // go through all player's pieces seeing if any of them could capture opposing King
-    const Piece *piece;
-    for (int row = 0; row < 8; row++)
-        for (int col = 0; col < 8; col++)
-        {
-            BoardModel::BoardSquare squareFrom(row, col);
-            if ((piece = pieceAt(squareFrom)) && piece->colour == player)
-                if (couldMoveFromTo(squareFrom, squareTo, true, false))
-                {
-                    from = squareFrom;
-                    to = squareTo;
-                    return true;
-                }
-        }
-    return false;
+    // ask for all player's pieces which could capture opposing King, reporting the first (in increasing row then column order)
+    BoardPosition::Bitboard attackers = _position.attackersTo(kingSquare, player);
+    if (!attackers)
+        return false;
+    int attackerSquare = BoardPosition::lowestSquare(attackers);
+    from = BoardSquare(BoardPosition::rowOf(attackerSquare), BoardPosition::colOf(attackerSquare));
+    to = BoardSquare(BoardPosition::rowOf(kingSquare), BoardPosition::colOf(kingSquare));
+    return true;
 }
 
-void BoardModel::clearBoardPieces(bool dontDelete /*= false*/)
+int BoardModel::positionRepetitionCount() const
 {
-    for (int row = 0; row < 8; row++)
-        for (int col = 0; col < 8; col++)
-        {
-            if (!dontDelete)
-                delete boardPieces[row][col];
-            boardPieces[row][col] = nullptr;
-        }
+    // return how many times the current position (with the same player to move) has occurred before in the game
+    // only every other ply can have the same player to move
+    ZobristKeys::Key key = positionKey();
+    int count = 0;
+    for (int ply = moveStack.index() - 2; ply >= 0; ply -= 2)
+        if (moveStack.keyAt(ply) == key)
+            count++;
+    return count;
+}
+
+void BoardModel::clearBoardPieces()
+{
+    _position.clear();
 }
 
 void BoardModel::addPiece(int row, int col, Piece::PieceColour colour, Piece::PieceName name, Piece::SideQualifier side /*= Piece::NoSide*/)
 {
-    Q_ASSERT(boardPieces[row][col] == nullptr);
-    Piece *piece = new Piece(colour, name, side);
-    boardPieces[row][col] = piece;
-    if (!modelBeingReset)
+    Piece piece(colour, name, side);
+    _position.addPiece(BoardPosition::square(row, col), piece);
+    if (!modelBeingReset && !inMoveBatch())
         emit pieceAdded(row, col, piece);
 }
 
 void BoardModel::removePiece(int row, int col)
 {
-    Q_ASSERT(boardPieces[row][col] != nullptr);
-    const Piece *piece = boardPieces[row][col];
-    delete boardPieces[row][col];
-    boardPieces[row][col] = nullptr;
-    if (!modelBeingReset)
-        emit pieceRemoved(piece);
+    _position.removePiece(BoardPosition::square(row, col));
+    if (!modelBeingReset && !inMoveBatch())
+        emit pieceRemoved(row, col);
 }
 
 void BoardModel::movePiece(int rowFrom, int colFrom, int rowTo, int colTo)
 {
-    Q_ASSERT(boardPieces[rowFrom][colFrom] != nullptr);
-    Q_ASSERT(boardPieces[rowTo][colTo] == nullptr);
-    Piece *piece = boardPieces[rowFrom][colFrom];
-    boardPieces[rowFrom][colFrom] = nullptr;
-    boardPieces[rowTo][colTo] = piece;
-    if (!modelBeingReset)
-        emit pieceMoved(rowTo, colTo, piece);
+    _position.movePiece(BoardPosition::square(rowFrom, colFrom), BoardPosition::square(rowTo, colTo));
+    if (!modelBeingReset && !inMoveBatch())
+        emit pieceMoved(rowFrom, colFrom, rowTo, colTo);
 }
 
 void BoardModel::checkForCheckAnimation()
 {
-    if (modelBeingReset)
+    if (modelBeingReset || inMoveBatch())
         return;
     // see if currently "in check" for animation
     BoardModel::BoardSquare from, to;
@@ -308,10 +136,12 @@ void BoardModel::setupInitialPieces()
 
 void BoardModel::newGame()
 {
-    undoMovesStack.clear();
     _moveHistoryModel->clear();
     Q_ASSERT(_moveHistoryModel->playerToMove() == Piece::White);
     setupInitialPieces();
+    _moveHistoryModel->setStartPosition(_position);
+    moveStack.clear(_position);
+    emit undoStackIndexChanged(moveStack.isClean());
     // let outside world we have (set up and) started a new game
     emit startedNewGame();
 }
@@ -329,40 +159,164 @@ bool BoardModel::parseAndMakeMove(Piece::PieceColour player, QString text)
         return false;
 
     // parse the move
-    MoveParser mp(this, player);
+    MoveParser mp(&_position, player);
     connect(&mp, &MoveParser::parserMessage, this, &BoardModel::parserMessage);
     QList<MoveParser::ParsedMove> moves;
-    if (!mp.parse(text, moves))
+    if (!mp.parse(text, moves, _moveParseCache))
+        return false;
+    Q_ASSERT(!moves.isEmpty());
+
+    // make the move(s) on the board model
+    // the move is pushed, packed, onto the move stack, from where it can be undone and redone
+    PackedMove move(mp.packMoves(moves));
+    makeUndoableMove(move);
+    moveStack.push(move, _position);
+    emit undoStackIndexChanged(moveStack.isClean());
+
+    return true;
+}
+
+bool BoardModel::replayMove(Piece::PieceColour player, const QString &text, QString *errorMessage /*= nullptr*/)
+{
+    // parse the "Descriptive" notation in `text` and make the move directly on the board
+    // this is the "headless" counterpart of `parseAndMakeMove()`, used by `GameReplayer` for bulk replay/validation
+    // no undo command is created, the move history is not updated and no check animation is looked for
+    // so the caller is responsible for alternating `player`
+    // return true => successfully parsed and move made
+    // return false => some kind of failure, `*errorMessage` (if passed) set to the parser's message
+
+    // parse the move
+    MoveParser mp(&_position, player);
+    QList<MoveParser::ParsedMove> moves;
+    if (!mp.parse(text, moves, _moveParseCache))
+    {
+        // the parser only reports why it failed via its `parserMessage()` signal
+        // to keep the (usual) success path free of any connection, only on failure do we connect and re-parse to collect it
+        if (errorMessage)
+        {
+            errorMessage->clear();
+            connect(&mp, &MoveParser::parserMessage, this, [errorMessage](const QString &msg) { *errorMessage = msg; });
+            mp.parse(text, moves);
+        }
         return false;
+    }
     Q_ASSERT(!moves.isEmpty());
 
     // make the move(s) on the board model
-    // we do this by creating an undoable `MoveUndoCommand` and pushing it to the undo stack
-    // that causes `doUndoableMoveCommand()` to be called first time
-    MoveUndoCommand *command = new MoveUndoCommand(this, player, text, moves);
-    undoMovesStack.push(command);
+    for (const auto &move : moves)
+        switch (move.moveType)
+        {
+        case MoveParser::Add: addPiece(move.to.row, move.to.col, move.piece.colour, move.piece.name); break;
+        case MoveParser::Remove: removePiece(move.to.row, move.to.col); break;
+        case MoveParser::Move: movePiece(move.from.row, move.from.col, move.to.row, move.to.col); break;
+        }
 
     return true;
 }
 
+void BoardModel::makeMoves(const QVector<PackedMove> &moves)
+{
+    // make moves already resolved (e.g. by `GameReplayer::resolveMoves()`) from the current position, pushing them onto the move stack
+    // the moves are made in a batch, and the move history is reset once for all of them, as `goToPly()` does
+    if (moves.isEmpty())
+        return;
+    beginMoveBatch();
+    for (const PackedMove &move : moves)
+    {
+        move.make(_position);
+        moveStack.push(move, _position);
+    }
+    _moveHistoryModel->resetMoves(moveStack.allMoves(), moveStack.index());
+    endMoveBatch();
+    emit undoStackIndexChanged(moveStack.isClean());
+}
+
 QAction *BoardModel::createUndoMoveAction(QObject *parent)
 {
     // create the "Undo Last Move" action
-    return undoMovesStack.createUndoAction(parent);
+    // this is just an adapter onto `undoMove()`, enabled while there is a move to undo
+    QAction *action = new QAction("Undo Last Move", parent);
+    action->setEnabled(moveStack.canUndo());
+    connect(action, &QAction::triggered, this, &BoardModel::undoMove);
+    connect(this, &BoardModel::undoStackIndexChanged, action, [this, action]() { action->setEnabled(moveStack.canUndo()); });
+    return action;
 }
 
 QAction *BoardModel::createRedoMoveAction(QObject *parent)
 {
     // create the "Redo Last Move" action
-    return undoMovesStack.createRedoAction(parent);
+    // this is just an adapter onto `redoMove()`, enabled while there is a move to redo
+    QAction *action = new QAction("Redo Last Move", parent);
+    action->setEnabled(moveStack.canRedo());
+    connect(action, &QAction::triggered, this, &BoardModel::redoMove);
+    connect(this, &BoardModel::undoStackIndexChanged, action, [this, action]() { action->setEnabled(moveStack.canRedo()); });
+    return action;
+}
+
+/*slot*/ void BoardModel::undoMove()
+{
+    // undo the last move made
+    if (!moveStack.canUndo())
+        return;
+    moveStack.setIndex(moveStack.index() - 1);
+    unmakeUndoableMove(moveStack.at(moveStack.index()));
+    emit undoStackIndexChanged(moveStack.isClean());
+}
+
+/*slot*/ void BoardModel::redoMove()
+{
+    // redo the last move undone
+    if (!moveStack.canRedo())
+        return;
+    makeUndoableMove(moveStack.at(moveStack.index()));
+    moveStack.setIndex(moveStack.index() + 1);
+    emit undoStackIndexChanged(moveStack.isClean());
+}
+
+void BoardModel::beginMoveBatch()
+{
+    // begin a batch of (possibly many) moves, e.g. running an opened game to its end
+    // while in a batch no per-piece, check or last move signals are emitted,
+    // instead `endMoveBatch()` emits a single `modelReset()` so that the board is redrawn just once for all the moves
+    // batches may be nested, only the outermost `endMoveBatch()` does this
+    moveBatchDepth++;
+}
+
+void BoardModel::endMoveBatch()
+{
+    // end a batch of moves begun by `beginMoveBatch()`
+    Q_ASSERT(moveBatchDepth > 0);
+    if (--moveBatchDepth > 0)
+        return;
+    emit modelReset();
+    emit lastMoveMade(_moveHistoryModel->textOfLastMoveMade());
+    // see if currently "in check" for animation
+    checkForCheckAnimation();
+}
+
+void BoardModel::goToPly(int ply)
+{
+    // go to the position after `ply` moves on the move stack, undoing or redoing as many moves as that takes
+    // rather than undoing/redoing each move in turn, with all its signals and animations,
+    // the position is set from the move stack's nearest snapshot and the board and move history are reset in one go
+    Q_ASSERT(ply >= 0 && ply <= moveStack.count());
+    if (ply == moveStack.index())
+        return;
+    beginMoveBatch();
+    moveStack.setIndex(ply);
+    _position = moveStack.positionAt(ply);
+    _moveHistoryModel->resetMoves(moveStack.allMoves(), ply);
+    endMoveBatch();
+    emit undoStackIndexChanged(moveStack.isClean());
 }
 
-void BoardModel::doUndoableMoveCommand(const MoveUndoCommand &command)
+void BoardModel::makeUndoableMove(const PackedMove &packedMove)
 {
-    // do a MoveUndoCommand, either first time or after an undo
+    // make a move, either first time or redoing it after an undo
 
     // make the move(s) on the board model
-    for (const auto &move : command.moves())
+    const QList<MoveParser::ParsedMove> moves(MoveParser::unpackMove(packedMove));
+    for (const auto &move : moves)
         switch (move.moveType)
         {
         case MoveParser::Add:
@@ -384,24 +338,27 @@ void BoardModel::doUndoableMoveCommand(const MoveUndoCommand &command)
     checkForCheckAnimation();
 
     // append the move to the history
-    _moveHistoryModel->appendMove(command.player(), command.moveText());
+    _moveHistoryModel->appendMove(packedMove);
     // emit signal with text of last move made (so UI can update)
-    emit lastMoveMade(command.moveText());
+    if (!inMoveBatch())
+        emit lastMoveMade(_moveHistoryModel->textOfLastMoveMade());
 }
 
-void BoardModel::undoUndoableMoveCommand(const MoveUndoCommand &command)
+void BoardModel::unmakeUndoableMove(const PackedMove &packedMove)
 {
-    // undo a MoveUndoCommand, after redo have previously been called
+    // unmake a move, which must be the last move made
 
     // remove the last move from the history
     _moveHistoryModel->removeLastMove();
     // emit signal with text of last move made, i.e. previous move (so UI can update)
-    emit lastMoveMade(_moveHistoryModel->textOfLastMoveMade());
+    if (!inMoveBatch())
+        emit lastMoveMade(_moveHistoryModel->textOfLastMoveMade());
 
     // make the *opposite* move(s) in reverse direction on the board model
-    for (int i = command.moves().length() - 1; i >=0; i--)
+    const QList<MoveParser::ParsedMove> moves(MoveParser::unpackMove(packedMove));
+    for (int i = moves.length() - 1; i >=0; i--)
     {
-        const auto &move(command.moves().at(i));
+        const auto &move(moves.at(i));
         switch (move.moveType)
         {
         case MoveParser::Add:
@@ -410,8 +367,8 @@ void BoardModel::undoUndoableMoveCommand(const MoveUndoCommand &command)
             break;
 
         case MoveParser::Remove:
-            // add the piece stored in `move.to` & `piece`
-            addPiece(move.to.row, move.to.col, move.piece.colour, move.piece.name);
+            // add the piece stored in `move.to` & `piece`, with the side it started on
+            addPiece(move.to.row, move.to.col, move.piece.colour, move.piece.name, move.piece.side);
             break;
 
         case MoveParser::Move:
@@ -430,7 +387,7 @@ void BoardModel::undoStackSetClean()
     // this is called from OpenedGameRunner::doStepOneMove() each time a new move is successfully read, parsed and made
     // so we can tell whether we have returned to exactly this state later on
     // which in turn tells us whether we can pick up where we got to in `OpenedGameRunner` stepping
-    undoMovesStack.setClean();
+    moveStack.setClean();
 }
 
 bool BoardModel::undoStackIsClean() const
@@ -440,22 +397,22 @@ bool BoardModel::undoStackIsClean() const
     // (a) any moves have been undone and have not been redone; or
     // (b) some other move(s) have been "manually"
     // either way if unclean this means we cannot afford to continue stepping through `OpenedGameRunner`
-    return undoMovesStack.isClean();
+    return moveStack.isClean();
 }
 
 void BoardModel::undoStackRestoreToClean()
 {
     // restore the undoStack to currently be "clean"
-    // this repeatedly calls `undo()` or `redo()` until the stack reaches the clean state
-    int cleanIndex = undoMovesStack.cleanIndex();
+    // this goes straight to the clean state's position, rather than undoing/redoing each move in between
+    int cleanIndex = moveStack.cleanIndex();
     if (cleanIndex >= 0)
-        undoMovesStack.setIndex(cleanIndex);
+        goToPly(cleanIndex);
 }
 
 bool BoardModel::undoStackCanRestoreToClean() const
 {
     // return whether the undoStack can restore to a "clean" state, i.e. `undoStackRestoreToClean()` can be called
-    return (undoMovesStack.cleanIndex() >= 0 && !undoMovesStack.isClean());
+    return (moveStack.cleanIndex() >= 0 && !moveStack.isClean());
 }
 
 void BoardModel::saveMoveHistory(QTextStream &ts, bool insertTurnNumber /*= true*/) const
@@ -466,55 +423,112 @@ void BoardModel::saveMoveHistory(QTextStream &ts, bool insertTurnNumber /*= true
 
 
 
-MoveParser::MoveParser(const BoardModel *model, Piece::PieceColour player)
+MoveParser::MoveParser(const BoardPosition *position, Piece::PieceColour player)
 {
-    this->model = model;
+    // parse moves by `player` on `position`, the position before the move
+    // the parser only looks at the position, so it can equally work on a `BoardModel`'s position or on a scratch one
+    this->position = position;
     this->player = player;
 }
 
-bool MoveParser::parsePieceName(QString text, Piece::PieceName &name) const
+void MoveParser::tokenize(QStringView text, MoveTokens &tokens)
+{
+    // split the text of a move, in a single pass, at its `-`s or, if there are none, at its `x`s (either case)
+    // fill `tokens` with views of (up to `MaxParts` of) the parts, no copies are made
+    int hyphenCount = 0, captureCount = 0;
+    int hyphenAt[MoveTokens::MaxParts], captureAt[MoveTokens::MaxParts];
+    for (int i = 0; i < text.length(); i++)
+    {
+        QChar ch = text.at(i);
+        if (ch == '-')
+        {
+            if (hyphenCount < MoveTokens::MaxParts)
+                hyphenAt[hyphenCount] = i;
+            hyphenCount++;
+        }
+        else if (ch == 'x' || ch == 'X')
+        {
+            if (captureCount < MoveTokens::MaxParts)
+                captureAt[captureCount] = i;
+            captureCount++;
+        }
+    }
+
+    int separatorCount = 0;
+    const int *separatorAt = nullptr;
+    tokens.separator = QChar();
+    if (hyphenCount > 0)
+    {
+        tokens.separator = '-';
+        separatorCount = hyphenCount;
+        separatorAt = hyphenAt;
+    }
+    else if (captureCount > 0)
+    {
+        tokens.separator = 'x';
+        separatorCount = captureCount;
+        separatorAt = captureAt;
+    }
+
+    tokens.partCount = separatorCount + 1;
+    int start = 0;
+    for (int i = 0; i < MoveTokens::MaxParts && i < tokens.partCount; i++)
+    {
+        int end = (i < separatorCount) ? separatorAt[i] : text.length();
+        tokens.parts[i] = text.mid(start, end - start);
+        start = end + 1;
+    }
+}
+
+bool MoveParser::parsePieceName(QStringView text, Piece::PieceName &name) const
 {
     // parse a piece name, like "K"
     // return true => successfully parsed, and `name` filled in for piece
     // return false => failed to parse
-    text = text.toUpper();
-    if (text == "K")
+    if (text.length() == 2 && text[0].toUpper() == 'K' && text[1].toUpper() == 'T')
+    {
+        name = Piece::Knight;
+        return true;
+    }
+    if (text.length() != 1)
+        return false;
+    QChar ch = text[0].toUpper();
+    if (ch == 'K')
         name = Piece::King;
-    else if (text == "Q")
+    else if (ch == 'Q')
         name = Piece::Queen;
-    else if (text == "B")
+    else if (ch == 'B')
         name = Piece::Bishop;
-    else if (text == "KT" || text == "N")
+    else if (ch == 'N')
         name = Piece::Knight;
-    else if (text == "R")
+    else if (ch == 'R')
         name = Piece::Rook;
-    else if (text == "P")
+    else if (ch == 'P')
         name = Piece::Pawn;
     else
         return false;
     return true;
 }
 
-bool MoveParser::parsePieceNameAndSide(QString text, Piece::PieceName &name, Piece::SideQualifier &side) const
+bool MoveParser::parsePieceNameAndSide(QStringView text, Piece::PieceName &name, Piece::SideQualifier &side) const
 {
     // parse a piece name with optional side qualifier, like "K" or "KB"
     // return true => successfully parsed, and `name` filled in for piece and `side` for side qualifier
     // return false => failed to parse
-    text = text.toUpper();
-
     side = Piece::NoSide;
     if (text.length() > 1 && text[1].isLetter())
     {
         // could be side qualifier like "KB"
-        if (text[0] == 'Q')
+        QChar first = text[0].toUpper();
+        if (first == 'Q')
         {
             side = Piece::QueenSide;
-            text = text.remove(0, 1);
+            text = text.mid(1);
         }
-        else if (text[0] == 'K' && text[1] != 'T')
+        else if (first == 'K' && text[1].toUpper() != 'T')
         {
             side = Piece::KingSide;
-            text = text.remove(0, 1);
+            text = text.mid(1);
         }
     }
 
@@ -528,38 +542,107 @@ bool MoveParser::parsePieceNameAndSide(QString text, Piece::PieceName &name, Pie
     return true;
 }
 
-QList<int> MoveParser::columnsForPieceAndSide(Piece::PieceName name, Piece::SideQualifier side) const
+BoardPosition::Bitboard MoveParser::columnsForPieceAndSide(Piece::PieceName name, Piece::SideQualifier side) const
 {
-    // return the list of columns which a piece-and-side could refer to, like "R", "KR" or "QBP"
-    QList<int> cols;
+    // return the column(s) which a piece-and-side could refer to, like "R", "KR" or "QBP"
+    // as a mask of all the squares in those columns, 0 => none
+    BoardPosition::Bitboard cols = 0;
     if (name == Piece::King)
-        cols << 4;
+        cols |= BoardPosition::columnMask(4);
     else if (name == Piece::Queen)
-        cols << 3;
+        cols |= BoardPosition::columnMask(3);
     else if (name == Piece::Bishop)
     {
         if (side != Piece::QueenSide)
-            cols << 5;
+            cols |= BoardPosition::columnMask(5);
         if (side != Piece::KingSide)
-            cols << 2;
+            cols |= BoardPosition::columnMask(2);
     }
     else if (name == Piece::Knight)
     {
         if (side != Piece::QueenSide)
-            cols << 6;
+            cols |= BoardPosition::columnMask(6);
         if (side != Piece::KingSide)
-            cols << 1;
+            cols |= BoardPosition::columnMask(1);
     }
     else if (name == Piece::Rook)
     {
         if (side != Piece::QueenSide)
-            cols << 7;
+            cols |= BoardPosition::columnMask(7);
         if (side != Piece::KingSide)
-            cols << 0;
+            cols |= BoardPosition::columnMask(0);
     }
     return cols;
 }
 
+bool MoveParser::parse(const QString &text, QList<ParsedMove> &moves, MoveParseCache *cache) const
+{
+    // parse the text of a move, as `parse()` below
+    // if there is a `cache` the moves are taken from it if already resolved, else parsed and then cached
+    // the cache key is worked out just once, for both looking up and (on a miss) inserting
+    if (!cache)
+        return parse(text, moves);
+    bool check;
+    const MoveParseCache::Key key(*position, player, cacheKeyText(text, check));
+    if (const QList<ParsedMove> *cachedMoves = cache->find(key, check))
+    {
+        moves = *cachedMoves;
+        return true;
+    }
+    if (!parse(text, moves))
+        return false;
+    cache->insert(key, check, givesCheck(moves), moves);
+    return true;
+}
+
+/*static*/ QString MoveParser::cacheKeyText(QStringView text, bool &check)
+{
+    // return `text` normalized for `MoveParseCache`, so that texts which `parse()` reads the same share an entry
+    // letters are upper-cased, the parser ignoring case, and on the rhs of a move or capture
+    // any check qualifier is dropped (`check` set to whether there was one) and any "e.p." is written "EP"
+    // the rest is kept as it is, so texts are only ever merged where the parser would strip the same qualifiers
+    MoveTokens tokens;
+    tokenize(text, tokens);
+    check = false;
+    bool castling = (tokens.separator != 'x' && tokens.parts[0].length() == 1 && (tokens.parts[0][0].toUpper() == 'O' || tokens.parts[0][0] == '0'));
+    if (castling || tokens.separator.isNull() || tokens.partCount != 2)
+        return text.toString().toUpper();
+    // as in `parseMoveToMove()`/`parseCaptureMove()`, check comes off the end of the rhs first, then any promotion, then any "e.p."
+    QStringView rhs(tokens.parts[1]);
+    parseCheckQualifier(rhs, check);
+    int equals = rhs.lastIndexOf('=');
+    QStringView promotion = (equals >= 0) ? rhs.mid(equals) : QStringView();
+    if (equals >= 0)
+        rhs.truncate(equals);
+    bool enpassant = false;
+    if (tokens.separator == 'x')
+        parseEnpassantQualifier(rhs, enpassant);
+    QString keyText;
+    keyText.reserve(text.length());
+    keyText.append(tokens.parts[0]).append(tokens.separator).append(rhs);
+    if (enpassant)
+        keyText.append(QLatin1String("EP"));
+    keyText.append(promotion);
+    return keyText.toUpper();
+}
+
+bool MoveParser::givesCheck(const QList<ParsedMove> &moves) const
+{
+    // return whether the moves `parse()` resolved a move or capture to pass the check test `resolveSquaresFromTo()` makes for "ch"
+    // i.e. the moving piece, as it is before the move, could capture the opposing King from where it moves to
+    for (const ParsedMove &move : moves)
+        if (move.moveType == Move)
+        {
+            int opposingKingSquare = position->kingSquare(Piece::opposingColour(player));
+            if (opposingKingSquare < 0)
+                return true;
+            std::optional<Piece> piece = pieceAt(move.from);
+            Q_ASSERT(piece);
+            return position->couldMoveFromTo(*piece, BoardPosition::square(move.to.row, move.to.col), opposingKingSquare, true, false);
+        }
+    return false;
+}
+
 bool MoveParser::parse(const QString &text, QList<ParsedMove> &moves) const
 {
     // parse the text of a move
@@ -567,35 +650,35 @@ bool MoveParser::parse(const QString &text, QList<ParsedMove> &moves) const
     // return false => could not be parsed, or "ambiguous" or "impossible"
     moves.clear();
 
-    // try for a move with a `-` (hyphen), i.e. some kind of move
-    QStringList tokens = text.split('-');
+    MoveTokens tokens;
+    tokenize(text, tokens);
 
-    if (tokens.length() > 0 && (tokens[0].toUpper() == "O" || tokens[0] == "0"))
+    // try for a move with a `-` (hyphen), i.e. some kind of move
+    if (tokens.separator != 'x' && tokens.parts[0].length() == 1 && (tokens.parts[0][0].toUpper() == 'O' || tokens.parts[0][0] == '0'))
     {
         // "O-O" or "O-O-O" castling move
         return parseCastlingMove(text, tokens, moves);
     }
-    if (tokens.length() == 2)
+    if (tokens.separator == '-' && tokens.partCount == 2)
     {
         // a move like "P-K4"
-        return parseMoveToMove(text, tokens[0], tokens[1], moves);
+        return parseMoveToMove(text, tokens.parts[0], tokens.parts[1], moves);
     }
     // move has a `-`, but we failed to parse it, e.g. too many `-`s
-    if (tokens.length() > 1)
+    if (tokens.separator == '-')
     {
         emit parserMessage(QString("Unrecognised input for apparently move-type move: \"%1\"").arg(text));
         return false;
     }
 
     // try for a move with an `x`, i.e. some kind of cpature
-    tokens = text.split("x", Qt::KeepEmptyParts, Qt::CaseInsensitive);
-    if (tokens.length() == 2)
+    if (tokens.separator == 'x' && tokens.partCount == 2)
     {
         // a capture like "PxP"
-        return parseCaptureMove(text, tokens[0], tokens[1], moves);
+        return parseCaptureMove(text, tokens.parts[0], tokens.parts[1], moves);
     }
     // move has a `x`, but we failed to parse it, e.g. too many `x`s
-    if (tokens.length() > 1)
+    if (tokens.separator == 'x')
     {
         emit parserMessage(QString("Unrecognised input for apparently capture-type move: \"%1\"").arg(text));
         return false;
@@ -605,20 +688,21 @@ bool MoveParser::parse(const QString &text, QList<ParsedMove> &moves) const
     return false;
 }
 
-bool MoveParser::parseCastlingMove(const QString &text, const QStringList &tokens, QList<ParsedMove> &moves) const
+bool MoveParser::parseCastlingMove(const QString &text, const MoveTokens &tokens, QList<ParsedMove> &moves) const
 {
     // try for a "O-O" or "O-O-O" castling move
     // fill `moves` with list of `ParsedMoves` for unique move found
+    auto isCastlingO = [](QStringView part) { return part.length() == 1 && (part[0].toUpper() == 'O' || part[0] == '0'); };
 
-    if (tokens.length() > 3 || tokens.length() < 2 || (tokens[1].toUpper() != "O" && tokens[1] != "0"))
+    if (tokens.partCount > 3 || tokens.partCount < 2 || !isCastlingO(tokens.parts[1]))
     {
         emit parserMessage(QString("Unrecognised castling-type move: \"%1\"").arg(text));
         return false;
     }
     bool kingSide = true;
-    if (tokens.length() == 3)
+    if (tokens.partCount == 3)
     {
-        if (tokens[2].toUpper() != "O" && tokens[2] != "0")
+        if (!isCastlingO(tokens.parts[2]))
         {
             emit parserMessage(QString("Unrecognised castling-type move: \"%1\"").arg(text));
             return false;
@@ -633,13 +717,13 @@ bool MoveParser::parseCastlingMove(const QString &text, const QStringList &token
     BoardModel::BoardSquare rookFrom(row, kingSide ? 7 : 0), rookTo(row, kingSide ? 5 : 3);
 
     // find the player's king & rook in the right places
-    const Piece *king = model->pieceAt(kingFrom);
+    std::optional<Piece> king = pieceAt(kingFrom);
     if (!king || king->name != Piece::King || king->colour != player)
     {
         emit parserMessage(QString("King not on King's square for castling-type move"));
         return false;
     }
-    const Piece *rook = model->pieceAt(rookFrom);
+    std::optional<Piece> rook = pieceAt(rookFrom);
     if (!rook || rook->name != Piece::Rook || rook->colour != player)
     {
         emit parserMessage(QString("Rook not on Rook's square for castling-type move"));
@@ -647,8 +731,8 @@ bool MoveParser::parseCastlingMove(const QString &text, const QStringList &token
     }
 
     // check no other pieces in the way
-    if (model->pieceAt(kingTo) || model->pieceAt(rookTo) ||
-            (!kingSide && model->pieceAt(row, 1)))
+    if (pieceAt(kingTo) || pieceAt(rookTo) ||
+            (!kingSide && pieceAt(BoardModel::BoardSquare(row, 1))))
     {
         emit parserMessage(QString("Intervening pieces for castling-type move"));
         return false;
@@ -661,13 +745,13 @@ bool MoveParser::parseCastlingMove(const QString &text, const QStringList &token
     return true;
 }
 
-bool MoveParser::parseMoveToMove(const QString &text, const QString &lhs, const QString &rhs, QList<ParsedMove> &moves) const
+bool MoveParser::parseMoveToMove(const QString &text, QStringView lhs, QStringView rhs, QList<ParsedMove> &moves) const
 {
     // try for a move like "P-K4"
     // fill `moves` with list of `ParsedMoves` for unique move found
 
     // parse the piece and the possible source squares to move from on the lhs
-    QList<BoardModel::BoardSquare> squaresFrom;
+    BoardModel::BoardSquareSet squaresFrom;
     if (!parsePieceMoveFrom(lhs, squaresFrom))
     {
         emit parserMessage(QString("Unrecognised piece to move: \"%1\"").arg(lhs));
@@ -679,7 +763,7 @@ bool MoveParser::parseMoveToMove(const QString &text, const QString &lhs, const
         return false;
     }
 
-    QString rhs2(rhs);
+    QStringView rhs2(rhs);
     // see if there is "check" at the end of the rhs
     bool check;
     parseCheckQualifier(rhs2, check);
@@ -689,7 +773,7 @@ bool MoveParser::parseMoveToMove(const QString &text, const QString &lhs, const
         return false;
 
     // parse the possible destination squares to move to on the rhs
-    QList<BoardModel::BoardSquare> squaresTo;
+    BoardModel::BoardSquareSet squaresTo;
     if (!parseMoveTo(rhs2, squaresTo))
     {
         emit parserMessage(QString("Unrecognised square to move to: \"%1\"").arg(rhs));
@@ -719,10 +803,10 @@ bool MoveParser::parseMoveToMove(const QString &text, const QString &lhs, const
     // found unique from/to move
     BoardModel::BoardSquare squareFrom(squaresFromTo[0].from), squareTo(squaresFromTo[0].to);
 
-    Piece *piece = model->pieceAt(squareFrom);
+    std::optional<Piece> piece = pieceAt(squareFrom);
     Q_ASSERT(piece && piece->colour == player);
     // not allowed for a move if destination is occupied
-    if (model->pieceAt(squareTo))
+    if (pieceAt(squareTo))
     {
         emit parserMessage(QString("Square to move to is occupied: \"%1\"").arg(text));
         return false;
@@ -741,13 +825,13 @@ bool MoveParser::parseMoveToMove(const QString &text, const QString &lhs, const
     return true;
 }
 
-bool MoveParser::parseCaptureMove(const QString &text, const QString &lhs, const QString &rhs, QList<ParsedMove> &moves) const
+bool MoveParser::parseCaptureMove(const QString &text, QStringView lhs, QStringView rhs, QList<ParsedMove> &moves) const
 {
     // try for a capture like "PxP"
     // fill `moves` with list of `ParsedMoves` for unique move found
 
     // parse the piece and the possible source squares to move from on the lhs
-    QList<BoardModel::BoardSquare> squaresFrom;
+    BoardModel::BoardSquareSet squaresFrom;
     if (!parsePieceMoveFrom(lhs, squaresFrom))
     {
         emit parserMessage(QString("Unrecognised piece to move: \"%1\"").arg(lhs));
@@ -759,7 +843,7 @@ bool MoveParser::parseCaptureMove(const QString &text, const QString &lhs, const
         return false;
     }
 
-    QString rhs2(rhs);
+    QStringView rhs2(rhs);
     // see if there is "check" at the end of the rhs
     bool check;
     parseCheckQualifier(rhs2, check);
@@ -769,7 +853,7 @@ bool MoveParser::parseCaptureMove(const QString &text, const QString &lhs, const
         return false;
 
     // parse the possible piece/square to capture on the rhs
-    QList<BoardModel::BoardSquare> squaresTo;
+    BoardModel::BoardSquareSet squaresTo;
     bool enpassant;
     if (!parseCaptureAt(rhs2, squaresTo, enpassant))
     {
@@ -801,9 +885,9 @@ bool MoveParser::parseCaptureMove(const QString &text, const QString &lhs, const
     BoardModel::BoardSquare squareFrom(squaresFromTo[0].from), squareTo(squaresFromTo[0].to);
 
     // not allowed for a capture if destination is not occupied by opposing piece
-    Piece *piece = model->pieceAt(squareFrom);
+    std::optional<Piece> piece = pieceAt(squareFrom);
     Q_ASSERT(piece && piece->colour == player);
-    Piece *opposingPiece = model->pieceAt(squareTo);
+    std::optional<Piece> opposingPiece = pieceAt(squareTo);
     if (!opposingPiece || opposingPiece->colour == player)
     {
         emit parserMessage(QString("Square to capture is not occupied by opposing piece: \"%1\"").arg(text));
@@ -877,16 +961,18 @@ bool MoveParser::checkPawnPromotionLegality(const QString &text, Piece::PieceNam
     return true;
 }
 
-bool MoveParser::parsePawnPromotionQualifier(QString &rhs, Piece::PieceName &promotePawnToPiece) const
+bool MoveParser::parsePawnPromotionQualifier(QStringView &rhs, Piece::PieceName &promotePawnToPiece) const
 {
     // see if there is a (pawn) promotion ("=Q") at the end of the rhs
     // if there is, set `promotePawnToPiece` to the piece to promote to, else set it to `Piece::Pawn`
     // change `rhs` to have any promotion removed
     promotePawnToPiece = Piece::Pawn;
-    QRegularExpressionMatch match;
-    if (rhs.contains(QRegularExpression("^(.*)=(.*)$", QRegularExpression::CaseInsensitiveOption), &match))
+    int equals = rhs.length() - 1;
+    while (equals >= 0 && rhs[equals] != '=')
+        equals--;
+    if (equals >= 0)
     {
-        QString promotion = match.captured(2);
+        QStringView promotion = rhs.mid(equals + 1);
         if (!parsePieceName(promotion, promotePawnToPiece))
         {
             emit parserMessage(QString("Could not parse piece to promote to: \"%1\"").arg(rhs));
@@ -897,48 +983,73 @@ bool MoveParser::parsePawnPromotionQualifier(QString &rhs, Piece::PieceName &pro
             emit parserMessage(QString("Illegal piece to promote to: \"%1\"").arg(rhs));
             return false;
         }
-        rhs = match.captured(1);
+        rhs.truncate(equals);
     }
     return true;
 }
 
-void MoveParser::parseCheckQualifier(QString &rhs, bool &check) const
+/*static*/ void MoveParser::parseEnpassantQualifier(QStringView &rhs, bool &enpassant)
+{
+    // see if there is an "enpassant" ("ep", with optional `.`s after either letter) at the end of the rhs
+    // set `enpassant` correspondingly
+    // change `rhs` to have any enpassant removed
+    enpassant = false;
+    QStringView beforeEnpassant(rhs);
+    if (beforeEnpassant.endsWith('.'))
+        beforeEnpassant.chop(1);
+    if (beforeEnpassant.endsWith('p', Qt::CaseInsensitive))
+    {
+        beforeEnpassant.chop(1);
+        if (beforeEnpassant.endsWith('.'))
+            beforeEnpassant.chop(1);
+        if (beforeEnpassant.endsWith('e', Qt::CaseInsensitive))
+        {
+            beforeEnpassant.chop(1);
+            rhs = beforeEnpassant;
+            enpassant = true;
+        }
+    }
+}
+
+/*static*/ void MoveParser::parseCheckQualifier(QStringView &rhs, bool &check)
 {
     // see if there is a "check" ("ch" or "+") at the end of the rhs
     // set `check` correspondingly
     // change `rhs` to have any check removed
-    check = false;
-    QRegularExpressionMatch match;
-    if (rhs.contains(QRegularExpression("^(.*)(ch\\.?|\\+)$", QRegularExpression::CaseInsensitiveOption), &match))
-    {
-        check = true;
-        rhs = match.captured(1);
-    }
+    check = true;
+    if (rhs.endsWith('+'))
+        rhs.chop(1);
+    else if (rhs.endsWith(QLatin1String("ch."), Qt::CaseInsensitive))
+        rhs.chop(3);
+    else if (rhs.endsWith(QLatin1String("ch"), Qt::CaseInsensitive))
+        rhs.chop(2);
+    else
+        check = false;
 }
 
-bool MoveParser::parseFullPieceSpecifier(const QString &text, QString &preQualifier, Piece::PieceName &name, QString &postQualifier) const
+bool MoveParser::parseFullPieceSpecifier(QStringView text, QStringView &preQualifier, Piece::PieceName &name, QStringView &postQualifier) const
 {
     // parse a "full" piece specifier, like "K" or "QB" or "KKtP" or "R(B1)"
     // set `preQualifier` to anything coming before the piece, `name` to the (parsed) piece, `postQualifier` to anything coming after the piece
-    preQualifier = postQualifier = "";
-    QString pieceName;
-    for (int i = 0; i < text.length(); i++)
+    // the piece is the last name (one letter, or "Kt") before any `(`
+    int pieceStart = 0, pieceLength = 0;
+    int end = 0;
+    for (; end < text.length(); end++)
     {
-        QChar ch = text.at(i);
+        QChar ch = text.at(end);
         if (ch == '(')
-        {
-            postQualifier = text.mid(i);
             break;
-        }
-        preQualifier += pieceName;
-        pieceName = ch;
-        if (ch.toUpper() == 'K' && i + 1 < text.length() && text.at(i + 1).toLower() == 't')
-            pieceName += text.at(++i);
+        pieceStart = end;
+        pieceLength = 1;
+        if (ch.toUpper() == 'K' && end + 1 < text.length() && text.at(end + 1).toLower() == 't')
+            pieceLength++, end++;
     }
-    return parsePieceName(pieceName, name);
+    preQualifier = text.left(pieceStart);
+    postQualifier = text.mid(end);
+    return parsePieceName(text.mid(pieceStart, pieceLength), name);
 }
 
-bool MoveParser::parsePiecePreQualifier(const QString &qualifier, Piece::PieceName name, QList<BoardModel::BoardSquare> &squares) const
+bool MoveParser::parsePiecePreQualifier(QStringView qualifier, Piece::PieceName name, BoardModel::BoardSquareSet &squares) const
 {
     // parse a preceding "side-column" qualifier, like "K" or "QB"
     // `name` is the piece being qualified
@@ -951,17 +1062,15 @@ bool MoveParser::parsePiecePreQualifier(const QString &qualifier, Piece::PieceNa
     {
         // if moving piece is a pawn we have to allow for "K" or "QB" or "B"
         // figure which columns it could apply to
-        QList<int> cols = columnsForPieceAndSide(columnName, side);
-        if (cols.length() == 0)
+        BoardPosition::Bitboard cols = columnsForPieceAndSide(columnName, side);
+        if (cols == 0)
             return false;
         // only accept pawns currently located in those column(s)
         // there is a debate about whether "KP" should mean
         // (a) pawn which started on King's column, or
         // (b) pawn which is presently situated on King's column
         // we take the latter interpretation (actually for pawns this is probably the only correct one)
-        for (int i = squares.length() - 1; i >= 0; i--)
-            if (!cols.contains(squares[i].col))
-                squares.removeAt(i);
+        squares.squares &= cols;
     }
     else
     {
@@ -982,19 +1091,19 @@ bool MoveParser::parsePiecePreQualifier(const QString &qualifier, Piece::PieceNa
         // (a) rook which started on King's side, or
         // (b) rook which is presently situated on the King's side
         // we take the former interpretation
-        Piece *piece;
-        for (int i = squares.length() - 1; i >= 0; i--)
-            if ((piece = model->pieceAt(squares[i])) != nullptr && piece->side != side)
-                squares.removeAt(i);
+        std::optional<Piece> piece;
+        for (const auto square : BoardModel::BoardSquareSet(squares))
+            if ((piece = pieceAt(square)) && piece->side != side)
+                squares.remove(square);
     }
     return true;
 }
 
-bool MoveParser::parsePiecePostQualifier(const QString &qualifier, QList<BoardModel::BoardSquare> &squares) const
+bool MoveParser::parsePiecePostQualifier(QStringView qualifier, BoardModel::BoardSquareSet &squares) const
 {
     // parse a following "square" qualifier, like "(B1)" or "(KKt7)"
     // `squares` is all the squares the piece could be on, reduce this to satisfy the qualifier
-    QString squareQualifier;
+    QStringView squareQualifier;
     if (qualifier.startsWith('('))
     {
         if (!qualifier.endsWith(')'))
@@ -1007,26 +1116,26 @@ bool MoveParser::parsePiecePostQualifier(const QString &qualifier, QList<BoardMo
     // if the qualifier specified a row or any column(s)
     // remove any squares which do not match it
     int row;
-    QList<int> cols;
+    BoardPosition::Bitboard cols;
     if (!parseSquareSpecifier(squareQualifier, row, cols))
         return false;
-    for (int i = squares.length() - 1; i >= 0; i--)
-        if ((row != -1 && squares.at(i).row != row) ||
-                (!cols.isEmpty() && !cols.contains(squares.at(i).col)))
-            squares.removeAt(i);
+    if (row != -1)
+        squares.squares &= BoardPosition::rowMask(row);
+    if (cols != 0)
+        squares.squares &= cols;
 
     return true;
 }
 
-bool MoveParser::parseSquareSpecifier(const QString &specifier, int &row, QList<int> &cols) const
+bool MoveParser::parseSquareSpecifier(QStringView specifier, int &row, BoardPosition::Bitboard &cols) const
 {
     // parse a "square" specifier, used as the destination for a move like "P-K4" or in a "post-qualifier, like "R(R1)-Kt1" or "RxR(B7)"
     // set `row` to any row qualifier found, -1 => none
-    // set `cols` to any column(s) qualifier found, [] => none
+    // set `cols` to the mask of any column(s) qualifier found, 0 => none
 
     row = -1;
-    cols.clear();
-    QString squareSpecifier(specifier);
+    cols = 0;
+    QStringView squareSpecifier(specifier);
 
     // parse the digit at the end for the row
     if (!squareSpecifier.isEmpty())
@@ -1057,27 +1166,27 @@ bool MoveParser::parseSquareSpecifier(const QString &specifier, int &row, QList<
 
         // figure which columns it could apply to
         cols = columnsForPieceAndSide(columnName, side);
-        if (cols.length() == 0)
+        if (cols == 0)
             return false;
     }
 
     return true;
 }
 
-bool MoveParser::parsePieceMoveFrom(QString lhs, QList<BoardModel::BoardSquare> &squaresFrom) const
+bool MoveParser::parsePieceMoveFrom(QStringView lhs, BoardModel::BoardSquareSet &squaresFrom) const
 {
     // parse piece and (optionally) square to move from, like "K" or "QB"
-    // this produces a *list* of possible squares in `squaresFrom`, e.g. "P" could be any pawn
-    squaresFrom.clear();
+    // this produces a *set* of possible squares in `squaresFrom`, e.g. "P" could be any pawn
+    squaresFrom = BoardModel::BoardSquareSet();
 
     // parse to get the piece, optional preceded and/or followed by "qualifiers", like "K" or "QB" or "KKtP" or "R(B1)"
-    QString preQualifier, postQualifier;
+    QStringView preQualifier, postQualifier;
     Piece::PieceName name;
     if (!parseFullPieceSpecifier(lhs, preQualifier, name, postQualifier))
         return false;
 
     // find all squares these pieces are on
-    squaresFrom = model->findPieces(player, name);
+    squaresFrom = findPieces(player, name);
     if (squaresFrom.isEmpty())
         return false;
 
@@ -1093,51 +1202,44 @@ bool MoveParser::parsePieceMoveFrom(QString lhs, QList<BoardModel::BoardSquare>
     return true;
 }
 
-bool MoveParser::parseMoveTo(QString rhs, QList<BoardModel::BoardSquare> &squaresTo) const
+bool MoveParser::parseMoveTo(QStringView rhs, BoardModel::BoardSquareSet &squaresTo) const
 {
     // parse square to move to, like "K4" or "QB4"
-    // this produces a *list* of possible squares in `squaresTo`, e.g. "B4" could be either "KB4" or "QB4"
-    squaresTo.clear();
+    // this produces a *set* of possible squares in `squaresTo`, e.g. "B4" could be either "KB4" or "QB4"
+    squaresTo = BoardModel::BoardSquareSet();
 
     int row;
-    QList<int> cols;
+    BoardPosition::Bitboard cols;
     if (!parseSquareSpecifier(rhs, row, cols))
         return false;
     // must specify a row and at least one possible column
-    if (row == -1 || cols.isEmpty())
+    if (row == -1 || cols == 0)
         return false;
 
-    // build the list of possible squares to
-    for (int col : cols)
-        squaresTo.append({row, col});
+    // the possible squares to are the column(s) on the row
+    squaresTo.squares = cols & BoardPosition::rowMask(row);
 
     return true;
 }
 
-bool MoveParser::parseCaptureAt(QString rhs, QList<BoardModel::BoardSquare> &squaresTo, bool &enpassant) const
+bool MoveParser::parseCaptureAt(QStringView rhs, BoardModel::BoardSquareSet &squaresTo, bool &enpassant) const
 {
     // parse piece to capture, like "P" or "QBP"
-    // this produces a *list* of possible squares in `squaresTo`, e.g. "BP" could be either "KBP" or "QBP"
-    squaresTo.clear();
-    enpassant = false;  // not enpassant
+    // this produces a *set* of possible squares in `squaresTo`, e.g. "BP" could be either "KBP" or "QBP"
+    squaresTo = BoardModel::BoardSquareSet();
 
     // see if this is an "enpassant" capture ("ep") at the end
-    QRegularExpressionMatch match;
-    if (rhs.contains(QRegularExpression("^(.*)e\\.?p\\.?$", QRegularExpression::CaseInsensitiveOption), &match))
-    {
-        rhs = match.captured(1);
-        enpassant = true;
-    }
+    parseEnpassantQualifier(rhs, enpassant);
 
     // parse to get the piece, optional preceded and/or followed by "qualifiers", like "K" or "QB" or "KKtP" or "R(B1)"
-    QString preQualifier, postQualifier;
+    QStringView preQualifier, postQualifier;
     Piece::PieceName name;
     if (!parseFullPieceSpecifier(rhs, preQualifier, name, postQualifier))
         return false;
 
     // find all squares these pieces are on
     Piece::PieceColour opposingPlayer = Piece::opposingColour(player);
-    squaresTo = model->findPieces(opposingPlayer, name);
+    squaresTo = findPieces(opposingPlayer, name);
     if (squaresTo.isEmpty())
         return false;
 
@@ -1154,7 +1256,7 @@ bool MoveParser::parseCaptureAt(QString rhs, QList<BoardModel::BoardSquare> &squ
 }
 
 QList<BoardModel::BoardSquareFromTo> MoveParser::resolveSquaresFromTo(
-        const QList<BoardModel::BoardSquare> &squaresFrom, const QList<BoardModel::BoardSquare> &squaresTo,
+        const BoardModel::BoardSquareSet &squaresFrom, const BoardModel::BoardSquareSet &squaresTo,
         bool capture, bool enpassant, bool check) const
 {
     // given a list of possible squares to move from and squares to move to
@@ -1168,10 +1270,10 @@ QList<BoardModel::BoardSquareFromTo> MoveParser::resolveSquaresFromTo(
         return possibles;
 
     // go through each square from
-    QList<BoardModel::BoardSquare> squaresOpposingKing(model->findPieces(Piece::opposingColour(player), Piece::King));
+    int opposingKingSquare = position->kingSquare(Piece::opposingColour(player));
     for (const auto squareFrom : squaresFrom)
     {
-        const Piece *piece = model->pieceAt(squareFrom);
+        std::optional<Piece> piece = pieceAt(squareFrom);
         Q_ASSERT(piece);
         Q_ASSERT(piece->colour == player);
         // go through each square to
@@ -1179,39 +1281,204 @@ QList<BoardModel::BoardSquareFromTo> MoveParser::resolveSquaresFromTo(
         for (const auto squareTo : squaresTo)
         {
             // test for raw move to/capture at
-            if (!model->couldMoveFromTo(squareFrom, squareTo, capture, enpassant))
+            if (!position->couldMoveFromTo(*piece, BoardPosition::square(squareFrom.row, squareFrom.col), BoardPosition::square(squareTo.row, squareTo.col), capture, enpassant))
                 continue;
             // if `check` is true, test for that move resulting in check on opposing King
-            if (check && squaresOpposingKing.length() == 1)
-                if (!model->couldMoveFromTo(*piece, squareTo, squaresOpposingKing[0], true, false))
+            if (check && opposingKingSquare >= 0)
+                if (!position->couldMoveFromTo(*piece, BoardPosition::square(squareTo.row, squareTo.col), opposingKingSquare, true, false))
                     continue;
             possibles.append({squareFrom, squareTo});
         }
     }
+
+    // descriptive notation only distinguishes between *legal* moves, e.g. "N-Q2" when the other Knight which could go there is pinned
+    // so if more than one possible remains drop any which would leave player's own King in check
+    if (possibles.count() > 1 && !enpassant)
+    {
+        QList<BoardModel::BoardSquareFromTo> legalPossibles;
+        for (const auto &possible : possibles)
+        {
+            int squareFrom = BoardPosition::square(possible.from.row, possible.from.col);
+            int squareTo = BoardPosition::square(possible.to.row, possible.to.col);
+            PackedMove move(player, position->pieceAt(squareFrom)->name, squareFrom, squareTo);
+            if (capture)
+                move.setCapture(*position->pieceAt(squareTo), false);
+            if (!MoveGenerator::leavesKingInCheck(*position, move))
+                legalPossibles.append(possible);
+        }
+        if (!legalPossibles.isEmpty())
+            possibles = legalPossibles;
+    }
     return possibles;
 }
 
+PackedMove MoveParser::packMoves(const QList<ParsedMove> &moves) const
+{
+    // pack the `moves` which `parse()` filled in for a move into a `PackedMove`
+    // this must be called on the position before the move is made, where the moving piece is looked up
+    PackedMove move;
+    std::optional<Piece> captured;
+    int capturedSquare = -1;
+    for (const auto &parsedMove : moves)
+        switch (parsedMove.moveType)
+        {
+        case Remove:
+            // a piece removed before the piece moves is the piece captured, one removed after is the pawn being promoted
+            if (move.isNull())
+            {
+                captured = parsedMove.piece;
+                capturedSquare = BoardPosition::square(parsedMove.to.row, parsedMove.to.col);
+            }
+            break;
+
+        case Add:
+            // the piece the pawn is promoted to
+            move.setPromotion(parsedMove.piece.name);
+            break;
+
+        case Move: {
+            // the first move is the piece moving, a second one is the rook when castling
+            if (!move.isNull())
+            {
+                move.setCastling();
+                break;
+            }
+            int squareFrom = BoardPosition::square(parsedMove.from.row, parsedMove.from.col);
+            int squareTo = BoardPosition::square(parsedMove.to.row, parsedMove.to.col);
+            std::optional<Piece> piece = position->pieceAt(squareFrom);
+            Q_ASSERT(piece && piece->colour == player);
+            move = PackedMove(player, piece->name, squareFrom, squareTo);
+            // for enpassant the piece captured is not on the square moved to
+            if (captured)
+                move.setCapture(*captured, capturedSquare != squareTo);
+            break;
+        }
+        }
+    return move;
+}
+
+/*static*/ QList<MoveParser::ParsedMove> MoveParser::unpackMove(const PackedMove &move)
+{
+    // unpack a `PackedMove` into the `moves` which `parse()` filled in for it, in the same order
+    auto boardSquare = [](int square) { return BoardModel::BoardSquare(BoardPosition::rowOf(square), BoardPosition::colOf(square)); };
+    QList<ParsedMove> moves;
+    if (move.isCapture())
+        moves.append({ Remove, BoardModel::BoardSquare(), boardSquare(move.capturedSquare()), move.capturedPiece() });
+    moves.append({ Move, boardSquare(move.from()), boardSquare(move.to()) });
+    if (move.isCastling())
+        moves.append({ Move, boardSquare(move.castlingRookFrom()), boardSquare(move.castlingRookTo()) });
+    if (move.isPromotion())
+    {
+        moves.append({ Remove, BoardModel::BoardSquare(), boardSquare(move.to()), Piece(move.player(), Piece::Pawn) });
+        moves.append({ Add, BoardModel::BoardSquare(), boardSquare(move.to()), Piece(move.player(), move.promotedTo()) });
+    }
+    return moves;
+}
+
+QString MoveParser::moveText(const PackedMove &move) const
+{
+    // regenerate the descriptive text of `move`, which must be on the position before the move is made
+    // rather than working out how much qualifying the move needs, try texts from the shortest upwards
+    // and return the first which this parser parses back to exactly `move`
+    Q_ASSERT(move.player() == player);
+    QStringList texts;
+    if (move.isCastling())
+        texts.append(move.isKingSideCastling() ? "O-O" : "O-O-O");
+    else
+    {
+        // like "Kt-B3" up to "Kt(KKt1)-KB3", or "PxP" up to "P(K4)xP(Q5)"
+        QStringList lhss(pieceSpecifiers(move.from()));
+        QStringList rhss(move.isCapture() ? pieceSpecifiers(move.capturedSquare()) : squareSpecifiers(move.to()));
+        QString separator(move.isCapture() ? "x" : "-");
+        QString suffix;
+        if (move.isEnpassant())
+            suffix += "ep";
+        if (move.isPromotion())
+            suffix += "=" + pieceLetters(move.promotedTo());
+        for (const QString &lhs : lhss)
+            for (const QString &rhs : rhss)
+                texts.append(lhs + separator + rhs + suffix);
+        std::stable_sort(texts.begin(), texts.end(), [](const QString &a, const QString &b) { return a.length() < b.length(); });
+    }
 
+    // see whether the move gives check
+    BoardPosition positionAfter(*position);
+    move.make(positionAfter);
+    int opposingKingSquare = positionAfter.kingSquare(Piece::opposingColour(player));
+    bool check = opposingKingSquare >= 0 && positionAfter.attackersTo(opposingKingSquare, player);
 
-MoveUndoCommand::MoveUndoCommand(BoardModel *boardModel, Piece::PieceColour player, const QString &text, const QList<MoveParser::ParsedMove> &moves)
+    QList<ParsedMove> moves;
+    for (const QString &text : texts)
+    {
+        // a move giving check is written with "ch", if the parser accepts that (it does not for a "discovered" check)
+        if (check && parse(text + "ch", moves) && packMoves(moves) == move)
+            return text + "ch";
+        if (parse(text, moves) && packMoves(moves) == move)
+            return text;
+    }
+    // the last text fully qualifies the squares, so this should not be reached
+    return texts.last();
+}
+
+/*static*/ QString MoveParser::pieceLetters(Piece::PieceName name)
+{
+    // return the letter(s) for a piece, the opposite of `parsePieceName()`
+    switch (name)
+    {
+    case Piece::Bishop: return "B";
+    case Piece::King: return "K";
+    case Piece::Knight: return "Kt";
+    case Piece::Pawn: return "P";
+    case Piece::Queen: return "Q";
+    case Piece::Rook: return "R";
+    }
+    return QString();
+}
+
+/*static*/ QString MoveParser::columnName(int col)
 {
-    Q_ASSERT(boardModel);
-    this->_boardModel = boardModel;
-    this->_player = player;
-    this->_moveText = text;
-    this->_moves = moves;
-    this->setText("Last Move");
+    // return the name of a column, the opposite of `columnsForPieceAndSide()`
+    static const char *const columnNames[8] = { "QR", "QKt", "QB", "Q", "K", "KB", "KKt", "KR" };
+    Q_ASSERT(col >= 0 && col < 8);
+    return columnNames[col];
 }
 
-/*virtual*/ void MoveUndoCommand::redo() /*virtual*/
+QStringList MoveParser::squareSpecifiers(int square) const
 {
-    // do a MoveUndoCommand, either first time or after an undo
-    _boardModel->doUndoableMoveCommand(*this);
+    // return the ways of specifying `square` (as seen from `player`'s side of the board), from least to most qualified
+    // like "B3" and "KB3", or just "K4"
+    int row = BoardPosition::rowOf(square);
+    QString rank(QString::number((player == Piece::White) ? row + 1 : 8 - row));
+    QString column(columnName(BoardPosition::colOf(square)));
+    QStringList specifiers;
+    if (column.length() > 1)
+        specifiers.append(column.mid(1) + rank);
+    specifiers.append(column + rank);
+    return specifiers;
 }
 
-/*virtual*/ void MoveUndoCommand::undo() /*override*/
+QStringList MoveParser::pieceSpecifiers(int square) const
 {
-    // undo a MoveUndoCommand, after redo have previously been called
-    _boardModel->undoUndoableMoveCommand(*this);
+    // return the ways of specifying the piece (of either colour) on `square`, from least to most qualified
+    // like "Kt", "KKt" and "Kt(KB3)", or for a pawn "P", "BP", "KBP" and "P(KB3)"
+    std::optional<Piece> piece = position->pieceAt(square);
+    Q_ASSERT(piece);
+    QString letters(pieceLetters(piece->name));
+    QStringList specifiers{ letters };
+    if (piece->name == Piece::Pawn)
+    {
+        // a pawn can be qualified by the column it is on
+        QString column(columnName(BoardPosition::colOf(square)));
+        if (column.length() > 1)
+            specifiers.append(column.mid(1) + letters);
+        specifiers.append(column + letters);
+    }
+    else if (piece->name != Piece::King && piece->name != Piece::Queen && piece->side != Piece::NoSide)
+    {
+        // another piece can be qualified by the side it started on
+        specifiers.append((piece->side == Piece::KingSide ? "K" : "Q") + letters);
+    }
+    specifiers.append(letters + '(' + squareSpecifiers(square).last() + ')');
+    return specifiers;
 }
 
@@ -1,16 +1,22 @@
 #ifndef BOARDMODEL_H
 #define BOARDMODEL_H
 
+#include <optional>
+
 #include <QAbstractTableModel>
 #include <QList>
 #include <QObject>
+#include <QStringList>
+#include <QStringView>
 #include <QTextStream>
-#include <QUndoStack>
 
 #include "piece.h"
+#include "boardposition.h"
 #include "movehistorymodel.h"
+#include "movestack.h"
+#include "packedmove.h"
 
-class MoveUndoCommand;
+class MoveParseCache;
 
 class BoardModel : public QObject
 {
@@ -21,10 +27,12 @@ public:
     ~BoardModel();
 
 private:
-    Piece *boardPieces[8][8];
+    BoardPosition _position;
     MoveHistoryModel *_moveHistoryModel;
-    QUndoStack undoMovesStack;
+    MoveStack moveStack;
     bool modelBeingReset;
+    int moveBatchDepth;
+    MoveParseCache *_moveParseCache;
 
 public:
     struct BoardSquare
@@ -33,6 +41,28 @@ public:
         BoardSquare() {}
         BoardSquare(int row, int col) { this->row = row; this->col = col; }
     };
+    class BoardSquareSet
+    {
+        // a set of squares, held as a bitboard, which can be iterated as `BoardSquare`s
+        // e.g. `findPieces()` returns a view of the position's bitboard for a piece type & colour, without allocating
+    public:
+        BoardPosition::Bitboard squares;
+        BoardSquareSet(BoardPosition::Bitboard squares = 0) { this->squares = squares; }
+
+        struct const_iterator
+        {
+            BoardPosition::Bitboard remaining;
+            BoardSquare operator*() const { int square = BoardPosition::lowestSquare(remaining); return BoardSquare(BoardPosition::rowOf(square), BoardPosition::colOf(square)); }
+            const_iterator &operator++() { remaining &= remaining - 1; return *this; }
+            bool operator!=(const const_iterator &other) const { return remaining != other.remaining; }
+        };
+        inline const_iterator begin() const { return { squares }; }
+        inline const_iterator end() const { return { 0 }; }
+        inline bool isEmpty() const { return squares == 0; }
+        inline int count() const { return qPopulationCount(squares); }
+        inline bool contains(const BoardSquare &square) const { return squares & BoardPosition::squareBit(BoardPosition::square(square.row, square.col)); }
+        inline void remove(const BoardSquare &square) { squares &= ~BoardPosition::squareBit(BoardPosition::square(square.row, square.col)); }
+    };
     struct BoardSquareFromTo
     {
         BoardSquare from, to;
@@ -40,41 +70,55 @@ public:
     };
 
     inline MoveHistoryModel *moveHistoryModel() { return _moveHistoryModel; }
-    inline Piece *pieceAt(int row, int col) const { return boardPieces[row][col]; }
-    inline Piece *pieceAt(const BoardSquare &square) const { return pieceAt(square.row, square.col); }
-    QList<BoardSquare> findPieces(Piece::PieceColour colour, Piece::PieceName name) const;
+    inline const BoardPosition &position() const { return _position; }
+    inline ZobristKeys::Key positionKey() const { return _position.key(_moveHistoryModel->playerToMove()); }
+    inline ZobristKeys::Key positionKeyAt(int ply) const { Q_ASSERT(ply >= 0 && ply <= moveStack.index()); return moveStack.keyAt(ply); }
+    int positionRepetitionCount() const;
+    inline std::optional<Piece> pieceAt(int row, int col) const { return _position.pieceAt(BoardPosition::square(row, col)); }
+    inline std::optional<Piece> pieceAt(const BoardSquare &square) const { return pieceAt(square.row, square.col); }
+    inline BoardSquareSet findPieces(Piece::PieceColour colour, Piece::PieceName name) const { return BoardSquareSet(_position.pieces(colour, name)); }
     bool couldMoveFromTo(const Piece &piece, const BoardSquare &squareFrom, const BoardSquare &squareTo, bool capture, bool enpassant) const;
     bool couldMoveFromTo(const BoardSquare &squareFrom, const BoardSquare &squareTo, bool capture, bool enpassant = false) const;
+    inline MoveParseCache *moveParseCache() const { return _moveParseCache; }
+    inline void setMoveParseCache(MoveParseCache *cache) { _moveParseCache = cache; }
     bool parseAndMakeMove(Piece::PieceColour player, QString text);
+    bool replayMove(Piece::PieceColour player, const QString &text, QString *errorMessage = nullptr);
+    void makeMoves(const QVector<PackedMove> &moves);
     QAction *createUndoMoveAction(QObject *parent);
     QAction *createRedoMoveAction(QObject *parent);
-    void doUndoableMoveCommand(const MoveUndoCommand &command);
-    void undoUndoableMoveCommand(const MoveUndoCommand &command);
+    void beginMoveBatch();
+    void endMoveBatch();
+    inline bool inMoveBatch() const { return moveBatchDepth > 0; }
+    void goToPly(int ply);
     void undoStackSetClean();
     bool undoStackIsClean() const;
     void undoStackRestoreToClean();
     bool undoStackCanRestoreToClean() const;
     void saveMoveHistory(QTextStream &ts, bool insertTurnNumber = true) const;
 
-private:
-    bool obstructedMoveFromTo(const BoardSquare &squareFrom, const BoardSquare &squareTo) const;
     bool checkForCheck(BoardModel::BoardSquare &from, BoardModel::BoardSquare &to) const;
-    void clearBoardPieces(bool dontDelete = false);
+
+private:
+    void clearBoardPieces();
     void addPiece(int row, int col, Piece::PieceColour colour, Piece::PieceName name, Piece::SideQualifier side = Piece::NoSide);
     void removePiece(int row, int col);
     void movePiece(int rowFrom, int colFrom, int rowTo, int colTo);
     void checkForCheckAnimation();
     void setupInitialPieces();
+    void makeUndoableMove(const PackedMove &packedMove);
+    void unmakeUndoableMove(const PackedMove &packedMove);
 
 public slots:
     void newGame();
+    void undoMove();
+    void redoMove();
 
 signals:
     void startedNewGame();
     void modelReset();
-    void pieceAdded(int row, int col, const Piece *);
-    void pieceRemoved(const Piece *);
-    void pieceMoved(int row, int col, const Piece *);
+    void pieceAdded(int row, int col, const Piece &piece);
+    void pieceRemoved(int row, int col);
+    void pieceMoved(int rowFrom, int colFrom, int rowTo, int colTo);
     void showCheck(int fromRow, int fromCol, int toRow, int toCol);
     void lastMoveMade(const QString &moveText);
     void undoStackIndexChanged(bool clean);
@@ -87,7 +131,7 @@ class MoveParser : public QObject
     Q_OBJECT
 
 public:
-    MoveParser(const BoardModel *model, Piece::PieceColour player);
+    MoveParser(const BoardPosition *position, Piece::PieceColour player);
 
     enum ParsedMoveType { Add, Remove, Move };
     struct ParsedMove
@@ -98,51 +142,56 @@ public:
     };
 
     bool parse(const QString &text, QList<ParsedMove> &moves) const;
+    bool parse(const QString &text, QList<ParsedMove> &moves, MoveParseCache *cache) const;
+    PackedMove packMoves(const QList<ParsedMove> &moves) const;
+    static QList<ParsedMove> unpackMove(const PackedMove &move);
+    QString moveText(const PackedMove &move) const;
 
 private:
-    const BoardModel *model;
+    // the text of a move split at its `-` (a move) or, if none, its `x` (a capture)
+    // views into the original text, so tokenizing does not allocate
+    struct MoveTokens
+    {
+        static constexpr int MaxParts = 3;
+        QChar separator;            // '-', 'x', or null => neither found
+        int partCount = 0;          // number of parts the text splits into at `separator`
+        QStringView parts[MaxParts];    // the first `MaxParts` parts
+    };
+
+    const BoardPosition *position;
     Piece::PieceColour player;
-    bool parsePieceName(QString text, Piece::PieceName &name) const;
-    bool parsePieceNameAndSide(QString text, Piece::PieceName &name, Piece::SideQualifier &side) const;
-    QList<int> columnsForPieceAndSide(Piece::PieceName name, Piece::SideQualifier side) const;
-    bool parseCastlingMove(const QString &text, const QStringList &tokens, QList<ParsedMove> &moves) const;
-    bool parseMoveToMove(const QString &text, const QString &lhs, const QString &rhs, QList<ParsedMove> &moves) const;
-    bool parseCaptureMove(const QString &text, const QString &lhs, const QString &rhs, QList<ParsedMove> &moves) const;
+    inline std::optional<Piece> pieceAt(const BoardModel::BoardSquare &square) const { return position->pieceAt(BoardPosition::square(square.row, square.col)); }
+    inline BoardModel::BoardSquareSet findPieces(Piece::PieceColour colour, Piece::PieceName name) const { return BoardModel::BoardSquareSet(position->pieces(colour, name)); }
+    static void tokenize(QStringView text, MoveTokens &tokens);
+    bool parsePieceName(QStringView text, Piece::PieceName &name) const;
+    bool parsePieceNameAndSide(QStringView text, Piece::PieceName &name, Piece::SideQualifier &side) const;
+    BoardPosition::Bitboard columnsForPieceAndSide(Piece::PieceName name, Piece::SideQualifier side) const;
+    bool parseCastlingMove(const QString &text, const MoveTokens &tokens, QList<ParsedMove> &moves) const;
+    bool parseMoveToMove(const QString &text, QStringView lhs, QStringView rhs, QList<ParsedMove> &moves) const;
+    bool parseCaptureMove(const QString &text, QStringView lhs, QStringView rhs, QList<ParsedMove> &moves) const;
     void appendMovesForPawnPromotion(const Piece &piece, Piece::PieceName promotePawnToPiece, const BoardModel::BoardSquare &squareTo, QList<ParsedMove> &moves) const;
     bool checkPawnPromotionLegality(const QString &text, Piece::PieceName promotePawnToPiece, const Piece &piece, const BoardModel::BoardSquare &squareTo) const;
-    bool parsePawnPromotionQualifier(QString &rhs, Piece::PieceName &promotePawnToPiece) const;
-    void parseCheckQualifier(QString &rhs, bool &check) const;
-    bool parseFullPieceSpecifier(const QString &text, QString &preQualifier, Piece::PieceName &name, QString &postQualifier) const;
-    bool parsePiecePreQualifier(const QString &qualifier, Piece::PieceName name, QList<BoardModel::BoardSquare> &squares) const;
-    bool parsePiecePostQualifier(const QString &qualifier, QList<BoardModel::BoardSquare> &squares) const;
-    bool parseSquareSpecifier(const QString &specifier, int &row, QList<int> &cols) const;
-    bool parsePieceMoveFrom(QString rhs, QList<BoardModel::BoardSquare> &squaresFrom) const;
-    bool parseMoveTo(QString rhs, QList<BoardModel::BoardSquare> &squaresTo) const;
-    QList<BoardModel::BoardSquareFromTo> resolveSquaresFromTo(const QList<BoardModel::BoardSquare> &squaresFrom, const QList<BoardModel::BoardSquare> &squaresTo, bool capture, bool enpassant, bool check) const;
-    bool parseCaptureAt(QString rhs, QList<BoardModel::BoardSquare> &squaresTo, bool &enpassant) const;
+    bool parsePawnPromotionQualifier(QStringView &rhs, Piece::PieceName &promotePawnToPiece) const;
+    static void parseCheckQualifier(QStringView &rhs, bool &check);
+    static void parseEnpassantQualifier(QStringView &rhs, bool &enpassant);
+    static QString cacheKeyText(QStringView text, bool &check);
+    bool givesCheck(const QList<ParsedMove> &moves) const;
+    bool parseFullPieceSpecifier(QStringView text, QStringView &preQualifier, Piece::PieceName &name, QStringView &postQualifier) const;
+    bool parsePiecePreQualifier(QStringView qualifier, Piece::PieceName name, BoardModel::BoardSquareSet &squares) const;
+    bool parsePiecePostQualifier(QStringView qualifier, BoardModel::BoardSquareSet &squares) const;
+    bool parseSquareSpecifier(QStringView specifier, int &row, BoardPosition::Bitboard &cols) const;
+    bool parsePieceMoveFrom(QStringView lhs, BoardModel::BoardSquareSet &squaresFrom) const;
+    bool parseMoveTo(QStringView rhs, BoardModel::BoardSquareSet &squaresTo) const;
+    static QString pieceLetters(Piece::PieceName name);
+    static QString columnName(int col);
+    QStringList squareSpecifiers(int square) const;
+    QStringList pieceSpecifiers(int square) const;
+    QList<BoardModel::BoardSquareFromTo> resolveSquaresFromTo(const BoardModel::BoardSquareSet &squaresFrom, const BoardModel::BoardSquareSet &squaresTo, bool capture, bool enpassant, bool check) const;
+    bool parseCaptureAt(QStringView rhs, BoardModel::BoardSquareSet &squaresTo, bool &enpassant) const;
 
 signals:
     void parserMessage(const QString &msg) const;
 };
 
 
-class MoveUndoCommand : public QUndoCommand
-{
-public:
-    MoveUndoCommand(BoardModel *boardModel, Piece::PieceColour player, const QString &text, const QList<MoveParser::ParsedMove> &moves);
-
-    virtual void redo() override;
-    virtual void undo() override;
-
-    Piece::PieceColour player() const { return _player; }
-    const QString &moveText() const { return _moveText; }
-    const QList<MoveParser::ParsedMove> &moves() const { return _moves; }
-
-private:
-    BoardModel *_boardModel;
-    Piece::PieceColour _player;
-    QString _moveText;
-    QList<MoveParser::ParsedMove> _moves;
-};
-
 #endif // BOARDMODEL_H
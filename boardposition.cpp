@@ -0,0 +1,184 @@
+#include <cstring>
+
+#include "boardposition.h"
+
+BoardPosition::BoardPosition()
+{
+    clear();
+}
+
+void BoardPosition::clear()
+{
+    // remove all pieces from the board
+    _byColour[Piece::White] = _byColour[Piece::Black] = 0;
+    for (Bitboard &bitboard : _byName)
+        bitboard = 0;
+    std::memset(_squares, EmptySquare, sizeof(_squares));
+    _key = 0;
+}
+
+void BoardPosition::addPiece(int square, const Piece &piece)
+{
+    Q_ASSERT(square >= 0 && square < 64);
+    Q_ASSERT(!isOccupied(square));
+    _squares[square] = encodePiece(piece);
+    _byColour[piece.colour] |= squareBit(square);
+    _byName[piece.name] |= squareBit(square);
+    _key ^= zobristKeys.pieceSquare[piece.colour][piece.name][square];
+}
+
+void BoardPosition::removePiece(int square)
+{
+    Q_ASSERT(square >= 0 && square < 64);
+    Q_ASSERT(isOccupied(square));
+    quint8 code = _squares[square];
+    _squares[square] = EmptySquare;
+    _byColour[(code >> 3) & 1] &= ~squareBit(square);
+    _byName[code & 7] &= ~squareBit(square);
+    _key ^= zobristKeys.pieceSquare[(code >> 3) & 1][code & 7][square];
+}
+
+void BoardPosition::movePiece(int squareFrom, int squareTo)
+{
+    Q_ASSERT(squareFrom >= 0 && squareFrom < 64 && squareTo >= 0 && squareTo < 64);
+    Q_ASSERT(isOccupied(squareFrom));
+    Q_ASSERT(!isOccupied(squareTo));
+    quint8 code = _squares[squareFrom];
+    _squares[squareFrom] = EmptySquare;
+    _squares[squareTo] = code;
+    Bitboard fromTo = squareBit(squareFrom) | squareBit(squareTo);
+    _byColour[(code >> 3) & 1] ^= fromTo;
+    _byName[code & 7] ^= fromTo;
+    _key ^= zobristKeys.pieceSquare[(code >> 3) & 1][code & 7][squareFrom] ^ zobristKeys.pieceSquare[(code >> 3) & 1][code & 7][squareTo];
+}
+
+int BoardPosition::kingSquare(Piece::PieceColour colour) const
+{
+    // return the square of `colour`'s King, -1 => there is not exactly one King
+    // the King's bitboard is kept up to date by `addPiece()`/`removePiece()`/`movePiece()`, so this needs no search
+    Bitboard kings = pieces(colour, Piece::King);
+    if (!kings || (kings & (kings - 1)))
+        return -1;
+    return lowestSquare(kings);
+}
+
+BoardPosition::Bitboard BoardPosition::sideQualified(Piece::SideQualifier side) const
+{
+    // return the squares of all pieces, of either colour, with side qualifier `side`
+    Bitboard squares = 0;
+    for (Bitboard pieces = occupied(); pieces; pieces &= pieces - 1)
+    {
+        int square = lowestSquare(pieces);
+        if (((_squares[square] >> 4) & 3) == side)
+            squares |= squareBit(square);
+    }
+    return squares;
+}
+
+BoardPosition::Bitboard BoardPosition::attackersTo(int square, Piece::PieceColour colour) const
+{
+    // return the squares of all `colour`'s pieces which could capture on `square`
+    // i.e. those for which `couldMoveFromTo(piece, from, square, true, false)` holds, assuming `square` holds an opposing piece
+    // rather than trying every piece this works outwards from `square`: a knight/king/pawn attacks it if it stands on a square
+    // a knight/king/opposing pawn on `square` would attack, a line piece if it is on one of `square`'s lines with nothing between
+    Bitboard attackers = (pieces(colour, Piece::Knight) & attackTables.knightAttacks[square])
+            | (pieces(colour, Piece::King) & attackTables.kingAttacks[square])
+            | (pieces(colour, Piece::Pawn) & attackTables.pawnAttacks[Piece::opposingColour(colour)][square]);
+    Bitboard queens = pieces(colour, Piece::Queen);
+    Bitboard lineAttackers = ((pieces(colour, Piece::Rook) | queens) & attackTables.straightLines[square])
+            | ((pieces(colour, Piece::Bishop) | queens) & attackTables.diagonalLines[square]);
+    for (; lineAttackers; lineAttackers &= lineAttackers - 1)
+    {
+        int from = lowestSquare(lineAttackers);
+        if (!obstructedMoveFromTo(from, square))
+            attackers |= squareBit(from);
+    }
+    return attackers;
+}
+
+bool BoardPosition::couldMoveFromTo(const Piece &piece, int squareFrom, int squareTo, bool capture, bool enpassant) const
+{
+    // return whether the piece specified, if it were in `squareFrom` (which it may or may not be), could move to `squareTo`
+    // if `capture` it is a capture (possibly enpassant) move else it is a move move
+    // the geometry comes from the precomputed `attackTables`, with any obstruction being one test against the occupied squares
+
+    // can't move to square it is presently on
+    if (squareFrom == squareTo)
+        return false;
+    if (capture)
+    {
+        // square must be occupied by opposing piece
+        if (!(occupied(Piece::opposingColour(piece.colour)) & squareBit(squareTo)))
+            return false;
+        // and if it's enpassant both pieces must be a pawn
+        if (enpassant)
+            if (piece.name != Piece::Pawn || !(_byName[Piece::Pawn] & squareBit(squareTo)))
+                return false;
+    }
+    else
+    {
+        // can't move to square occupied by either side
+        if (isOccupied(squareTo))
+            return false;
+    }
+
+    const Bitboard to = squareBit(squareTo);
+    switch (piece.name)
+    {
+    case Piece::King:
+        // kings move one square in any direction
+        // note that we do not allow the special 2-square move for castling here as that is handled specially elsewhere
+        return attackTables.kingAttacks[squareFrom] & to;
+
+    case Piece::Queen:
+        // queens move like rooks or bishops
+        return ((attackTables.straightLines[squareFrom] | attackTables.diagonalLines[squareFrom]) & to) && !obstructedMoveFromTo(squareFrom, squareTo);
+
+    case Piece::Rook:
+        // rooks move straight
+        // note that we do not allow the special 2/3-square move for castling here as that is handled specially elsewhere
+        return (attackTables.straightLines[squareFrom] & to) && !obstructedMoveFromTo(squareFrom, squareTo);
+
+    case Piece::Bishop:
+        // bishops move diagonally
+        return (attackTables.diagonalLines[squareFrom] & to) && !obstructedMoveFromTo(squareFrom, squareTo);
+
+    case Piece::Knight:
+        // knights move like knights move :)
+        return attackTables.knightAttacks[squareFrom] & to;
+
+    case Piece::Pawn: {
+        // rows increase in White's direction of travel, `forward` is +8/-8 squares for one row forward
+        const int forward = piece.isWhite() ? 8 : -8;
+        if (capture)
+        {
+            if (enpassant)
+            {
+                // check for special enpassant capture
+                // here `squareTo` will be the square *currently* occupied by the opposing pawn
+                // so this will actually look like a "sideways" move to that pawn's square
+                // outside world will then have to deal with adjusting the final position of the capturing pawn
+                // must be "sideways" to an adjacent column
+                if (rowOf(squareTo) != rowOf(squareFrom) || qAbs(colOf(squareTo) - colOf(squareFrom)) != 1)
+                    return false;
+                // captured pawn must be on 4th rank
+                if (rowOf(squareTo) != (piece.isWhite() ? 4 : 3))
+                    return false;
+                // the 2 squares behind the captured pawn must be empty, else this can't be enpassant
+                if (isOccupied(squareTo + forward) || isOccupied(squareTo + 2 * forward))
+                    return false;
+                return true;
+            }
+            // pawns capture diagonally forward 1 square
+            return attackTables.pawnAttacks[piece.colour][squareFrom] & to;
+        }
+        // pawns move straight forward 1 square, or 2 if they are on their starting row
+        if (squareTo == squareFrom + forward)
+            return true;
+        if (squareTo == squareFrom + 2 * forward && rowOf(squareFrom) == (piece.isWhite() ? 1 : 6))
+            return !obstructedMoveFromTo(squareFrom, squareTo);
+        return false;
+    }
+    }
+    return false;
+}
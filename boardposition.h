@@ -0,0 +1,65 @@
+#ifndef BOARDPOSITION_H
+#define BOARDPOSITION_H
+
+#include <optional>
+
+#include <QtAlgorithms>
+#include <QtGlobal>
+
+#include "attacktables.h"
+#include "piece.h"
+#include "zobristkeys.h"
+
+class BoardPosition
+{
+public:
+    BoardPosition();
+
+    // squares are numbered 0..63, `row * 8 + col`, so row 0/col 0 (White's QR1) is square 0
+    typedef quint64 Bitboard;
+    static constexpr int square(int row, int col) { return row * 8 + col; }
+    static constexpr int rowOf(int square) { return square >> 3; }
+    static constexpr int colOf(int square) { return square & 7; }
+    static constexpr Bitboard squareBit(int square) { return Bitboard(1) << square; }
+    static constexpr Bitboard rowMask(int row) { return Bitboard(0xFF) << (row * 8); }
+    static constexpr Bitboard columnMask(int col) { return Bitboard(0x0101010101010101) << col; }
+    static inline int lowestSquare(Bitboard bitboard) { Q_ASSERT(bitboard); return qCountTrailingZeroBits(bitboard); }
+
+    inline bool isOccupied(int square) const { return _squares[square] != EmptySquare; }
+    inline std::optional<Piece> pieceAt(int square) const { return isOccupied(square) ? std::optional<Piece>(decodePiece(_squares[square])) : std::nullopt; }
+    inline Bitboard occupied() const { return _byColour[Piece::White] | _byColour[Piece::Black]; }
+    inline Bitboard occupied(Piece::PieceColour colour) const { return _byColour[colour]; }
+    inline Bitboard pieces(Piece::PieceColour colour, Piece::PieceName name) const { return _byColour[colour] & _byName[name]; }
+    int kingSquare(Piece::PieceColour colour) const;
+    Bitboard sideQualified(Piece::SideQualifier side) const;
+    // the Zobrist key of the pieces on their squares, kept up to date by `addPiece()`/`removePiece()`/`movePiece()`
+    // `key(playerToMove)` includes the side to move, which the position itself does not know
+    inline ZobristKeys::Key key() const { return _key; }
+    inline ZobristKeys::Key key(Piece::PieceColour playerToMove) const { return (playerToMove == Piece::Black) ? _key ^ zobristKeys.blackToMove : _key; }
+
+    bool couldMoveFromTo(const Piece &piece, int squareFrom, int squareTo, bool capture, bool enpassant) const;
+    inline bool obstructedMoveFromTo(int squareFrom, int squareTo) const { return attackTables.between[squareFrom][squareTo] & occupied(); }
+    Bitboard attackersTo(int square, Piece::PieceColour colour) const;
+
+    void clear();
+    void addPiece(int square, const Piece &piece);
+    void removePiece(int square);
+    void movePiece(int squareFrom, int squareTo);
+
+private:
+    // each square holds a byte: 0 => empty, else `OccupiedBit` | side << 4 | colour << 3 | name
+    // the side is kept so that "KR"/"QR" etc. can still refer to where a piece started
+    enum { EmptySquare = 0, OccupiedBit = 0x80 };
+    Bitboard _byColour[2];
+    Bitboard _byName[6];
+    quint8 _squares[64];
+    ZobristKeys::Key _key;
+
+    static inline quint8 encodePiece(const Piece &piece) { return OccupiedBit | (piece.side << 4) | (piece.colour << 3) | piece.name; }
+    static inline Piece decodePiece(quint8 code)
+    {
+        return Piece(static_cast<Piece::PieceColour>((code >> 3) & 1), static_cast<Piece::PieceName>(code & 7), static_cast<Piece::SideQualifier>((code >> 4) & 3));
+    }
+};
+
+#endif // BOARDPOSITION_H
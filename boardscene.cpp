@@ -1,13 +1,128 @@
 #include <QApplication>
 #include <QDebug>
 #include <QPainter>
-#include <QParallelAnimationGroup>
 #include <QPropertyAnimation>
+#include <QTimer>
 #include <QtMath>
 
 #include "pieceimages.h"
 #include "boardscene.h"
 
+AnimationScheduler::AnimationScheduler(QObject *parent) :
+    QObject(parent)
+{
+    plyAnimationsRunning = 0;
+    plyOpen = false;
+    finishing = false;
+    durationScale = 1.0;
+}
+
+void AnimationScheduler::beginPly()
+{
+    // begin a new ply, which lasts till control returns to the event loop
+    // anything still animating from the previous ply is finished now, and the fact that it had not finished speeds up what follows
+    // (animations which outlive their ply play no part in this, they run on)
+    plyOpen = true;
+    QTimer::singleShot(0, this, [this]() { plyOpen = false; });
+    if (plyFinished())
+        durationScale = qMin(durationScale * 2, qreal(1.0));
+    else
+    {
+        durationScale = qMax(durationScale / 2, MinDurationScale);
+        finish(false);
+    }
+}
+
+void AnimationScheduler::animate(const Animation &animation)
+{
+    // run `animation`, as part of the current ply, now or (if `animation.afterPly`) when the ply's other animations have finished
+    if (!plyOpen)
+        beginPly();
+    if (animation.afterPly && plyAnimationsRunning > 0)
+        pending.append(animation);
+    else
+        start(animation);
+}
+
+void AnimationScheduler::start(const Animation &animation)
+{
+    // start `animation` on a `QPropertyAnimation` from the pool, creating one only if the pool is empty
+    QPropertyAnimation *propertyAnimation;
+    if (!pool.isEmpty())
+        propertyAnimation = pool.takeLast();
+    else
+    {
+        propertyAnimation = new QPropertyAnimation(this);
+        connect(propertyAnimation, &QPropertyAnimation::stateChanged,
+                this, [this, propertyAnimation](QAbstractAnimation::State newState, QAbstractAnimation::State oldState) {
+            Q_UNUSED(oldState);
+            if (newState == QAbstractAnimation::Stopped)
+                stopped(propertyAnimation);
+        } );
+    }
+    propertyAnimation->setTargetObject(animation.target);
+    propertyAnimation->setPropertyName(animation.propertyName);
+    propertyAnimation->setStartValue(animation.startValue);
+    propertyAnimation->setEndValue(animation.endValue);
+    propertyAnimation->setDuration(qMax(1, int(animation.duration * durationScale)));
+    propertyAnimation->setLoopCount(animation.loopCount);
+    running.insert(propertyAnimation, { animation.onStopped, animation.outlivesPly });
+    if (!animation.outlivesPly)
+        plyAnimationsRunning++;
+    if (animation.onStarted)
+        animation.onStarted();
+    propertyAnimation->start();
+}
+
+void AnimationScheduler::stopped(QPropertyAnimation *propertyAnimation)
+{
+    // an animation has stopped, finished or not: set its final state and return it to the pool
+    // when the last of a ply's animations stops, start any waiting for it
+    Running stoppedAnimation = running.take(propertyAnimation);
+    if (!stoppedAnimation.outlivesPly)
+        plyAnimationsRunning--;
+    propertyAnimation->setTargetObject(nullptr);
+    pool.append(propertyAnimation);
+    if (stoppedAnimation.onStopped)
+        stoppedAnimation.onStopped();
+    if (plyAnimationsRunning == 0 && !finishing)
+        while (!pending.isEmpty())
+            start(pending.takeFirst());
+}
+
+void AnimationScheduler::finishAnimationsOf(QObject *target)
+{
+    // finish at once any animation running on `target`
+    const QList<QPropertyAnimation *> propertyAnimations = running.keys();
+    for (QPropertyAnimation *propertyAnimation : propertyAnimations)
+        if (propertyAnimation->targetObject() == target)
+            propertyAnimation->stop();
+}
+
+void AnimationScheduler::finishAll()
+{
+    // finish at once all running animations, and drop any waiting to start
+    finish(true);
+}
+
+void AnimationScheduler::finish(bool outlivingPly)
+{
+    // finish at once the running animations, including those which outlive their ply only if `outlivingPly`,
+    // and drop any waiting to start
+    finishing = true;
+    const QList<QPropertyAnimation *> propertyAnimations = running.keys();
+    for (QPropertyAnimation *propertyAnimation : propertyAnimations)
+        if (outlivingPly || !running.value(propertyAnimation).outlivesPly)
+            propertyAnimation->stop();
+    const QList<Animation> dropped = pending;
+    pending.clear();
+    for (const Animation &animation : dropped)
+        if (animation.onStopped)
+            animation.onStopped();
+    finishing = false;
+}
+
+
 BoardScene::BoardScene(BoardModel *boardModel, QObject *parent) :
     QGraphicsScene(parent)
 {
@@ -15,9 +130,12 @@ BoardScene::BoardScene(BoardModel *boardModel, QObject *parent) :
     Q_ASSERT(boardModel);
     this->boardModel = boardModel;
     this->_pieceImages = nullptr;
-    this->itemMoveAnimation = this->itemFlashAnimation = this->checkMoveAnimation = nullptr;
+    this->animationScheduler = new AnimationScheduler(this);
     this->doAnimation = true;
     this->suspendAnimation = false;
+    for (auto &rowItems : squareItems)
+        for (BoardPiecePixmapItem *&item : rowItems)
+            item = nullptr;
 
     // attach model signals
     connect(boardModel, &BoardModel::pieceAdded, this, &BoardScene::addPiece);
@@ -29,6 +147,8 @@ BoardScene::BoardScene(BoardModel *boardModel, QObject *parent) :
 
 BoardScene::~BoardScene()
 {
+    // finish animations while the items they delete are still in the scene
+    terminateAllAnimations();
     if (_pieceImages)
         delete _pieceImages;
 }
@@ -60,25 +180,11 @@ void BoardScene::changePiecesColour(Piece::PieceColour player, const QColor &new
     redrawAllPieces();
 }
 
-void BoardScene::terminateAnimation(QPropertyAnimation *&itemAnimation)
-{
-    // terminate an animation (which might be) in progress
-    // note that this does so "abrubtly", it does not "finish" the animation so items do not reach their final state
-    if (itemAnimation)
-    {
-        if (itemAnimation->state() != QAbstractAnimation::Stopped)
-            itemAnimation->stop();
-        itemAnimation->deleteLater();
-        itemAnimation = nullptr;
-    }
-}
-
 void BoardScene::terminateAllAnimations()
 {
-    // terminate all animations (which might be) in progress
-    terminateAnimation(itemMoveAnimation);
-    terminateAnimation(itemFlashAnimation);
-    terminateAnimation(checkMoveAnimation);
+    // terminate all animations (which might be) in progress or waiting to start
+    // each is finished at once, so items reach their final state (and pieces animated away are deleted)
+    animationScheduler->finishAll();
 }
 
 
@@ -90,23 +196,17 @@ void BoardScene::animateAddPiece(BoardPiecePixmapItem *item)
         return;
     }
 
-    // only one flash animation allowed at a time
-    terminateAnimation(itemFlashAnimation);
-    Q_ASSERT(itemFlashAnimation == nullptr);
-    // set off an animated move calling `item->setPos()`
-    itemFlashAnimation = new QPropertyAnimation(item, "flash", this);
-    itemFlashAnimation->setStartValue(item->flashLevelMax);
-    itemFlashAnimation->setEndValue(0);
-    itemFlashAnimation->setDuration(500);
-    itemFlashAnimation->setLoopCount(3);
-    connect(itemFlashAnimation, &QPropertyAnimation::stateChanged,
-            this, [=](QAbstractAnimation::State newState, QAbstractAnimation::State oldState) {
-        Q_UNUSED(oldState);
-        // when animation finishes or is stopped, show the piece
-        if (newState == QAbstractAnimation::Stopped)
-            item->setFlashLevel(0);
-    } );
-    itemFlashAnimation->start();
+    // set off a flashing animation calling `item->setFlashLevel()`
+    // when animation finishes or is stopped, show the piece
+    AnimationScheduler::Animation animation;
+    animation.target = item;
+    animation.propertyName = "flash";
+    animation.startValue = item->flashLevelMax;
+    animation.endValue = 0;
+    animation.duration = 500;
+    animation.loopCount = 3;
+    animation.onStopped = [item]() { item->setFlashLevel(0); };
+    animationScheduler->animate(animation);
 }
 
 void BoardScene::animateRemovePiece(BoardPiecePixmapItem *item)
@@ -119,31 +219,21 @@ void BoardScene::animateRemovePiece(BoardPiecePixmapItem *item)
         return;
     }
 
-    // if there is a move animation on the item we are about to delete it must be terminated
-    if (itemMoveAnimation && itemMoveAnimation->targetObject() == item)
-        terminateAnimation(itemMoveAnimation);
-    // only one flash animation allowed at a time
-    terminateAnimation(itemFlashAnimation);
-    Q_ASSERT(itemFlashAnimation == nullptr);
-    terminateAnimation(checkMoveAnimation);
-    Q_ASSERT(checkMoveAnimation == nullptr);
-    // set off an animated move calling `item->setPos()`
-    itemFlashAnimation = new QPropertyAnimation(item, "flash", this);
-    itemFlashAnimation->setStartValue(item->flashLevelMax);
-    itemFlashAnimation->setEndValue(0);
-    itemFlashAnimation->setDuration(1000);
-    itemFlashAnimation->setLoopCount(3);
-    connect(itemFlashAnimation, &QPropertyAnimation::stateChanged,
-            this, [=](QAbstractAnimation::State newState, QAbstractAnimation::State oldState) {
-        Q_UNUSED(oldState);
-        // when animation finishes or is stopped, remove from scene and delete
-        if (newState == QAbstractAnimation::Stopped)
-        {
-            removeItem(item);
-            delete item;
-        }
-    } );
-    itemFlashAnimation->start();
+    // if there is an animation on the item (e.g. a pawn moving to be promoted) it must be finished first
+    animationScheduler->finishAnimationsOf(item);
+    // set off a flashing animation calling `item->setFlashLevel()`
+    // when animation finishes or is stopped, remove from scene and delete
+    AnimationScheduler::Animation animation;
+    animation.target = item;
+    animation.propertyName = "flash";
+    animation.startValue = item->flashLevelMax;
+    animation.endValue = 0;
+    animation.duration = 1000;
+    animation.loopCount = 3;
+    // a captured piece flashes away alongside the following moves, which neither wait for it nor cut it short
+    animation.outlivesPly = true;
+    animation.onStopped = [this, item]() { removeItem(item); delete item; };
+    animationScheduler->animate(animation);
 }
 
 void BoardScene::animateMovePiece(BoardPiecePixmapItem *item, const QPointF &startPos, const QPointF &endPos)
@@ -155,79 +245,60 @@ void BoardScene::animateMovePiece(BoardPiecePixmapItem *item, const QPointF &sta
         return;
     }
 
-    // only one move animation allowed at a time
-    terminateAnimation(itemMoveAnimation);
-    Q_ASSERT(itemMoveAnimation == nullptr);
-    terminateAnimation(checkMoveAnimation);
-    Q_ASSERT(checkMoveAnimation == nullptr);
     // set off an animated move calling `item->setPos()`
-    itemMoveAnimation = new QPropertyAnimation(item, "pos", this);
-    itemMoveAnimation->setStartValue(startPos);
-    itemMoveAnimation->setEndValue(endPos);
+    // when animation finishes or is stopped, move the piece to its destination
+    AnimationScheduler::Animation animation;
+    animation.target = item;
+    animation.propertyName = "pos";
+    animation.startValue = startPos;
+    animation.endValue = endPos;
     // calculate the duration based on the distance (longer moves take longer animation time)
     double xDist(endPos.x() - startPos.x()), yDist(endPos.y() - startPos.y());
     double distance = (xDist != 0 || yDist != 0) ? qSqrt(xDist * xDist + yDist * yDist) : 0;
-    itemMoveAnimation->setDuration(distance / 400 * 1000 + 200);
-    connect(itemMoveAnimation, &QPropertyAnimation::stateChanged,
-            this, [=](QAbstractAnimation::State newState, QAbstractAnimation::State oldState) {
-        Q_UNUSED(oldState);
-        // when animation finishes or is stopped, move the piece to its destination
-        if (newState == QAbstractAnimation::Stopped)
-            item->setPos(endPos);
-    } );
-    itemMoveAnimation->start();
+    animation.duration = distance / 400 * 1000 + 200;
+    animation.onStopped = [item, endPos]() { item->setPos(endPos); };
+    animationScheduler->animate(animation);
 }
 
 void BoardScene::animateShowCheck(const QPointF &startPos, const QPointF &endPos)
 {
     if (!doAnimation || suspendAnimation)
         return;
-    // only one move animation allowed at a time
-    terminateAnimation(checkMoveAnimation);
-    Q_ASSERT(checkMoveAnimation == nullptr);
-    // set off an animated move calling `item->setPos()`
+    // set off an animated move of a square outline calling `item->setPos()`
+    // this waits till the pieces moved in the ply have finished moving
     BoardSquareRectItem *item = new BoardSquareRectItem;
     item->setRect(0, 0, 100, 100);
     item->setPen(QPen(Qt::red, 4));
-    checkMoveAnimation = new QPropertyAnimation(item, "pos", this);
-    // delete new'ed item when delete checkMoveAnimation, however that occurs
-    item->setParent(checkMoveAnimation);
-    checkMoveAnimation->setStartValue(startPos);
-    checkMoveAnimation->setEndValue(endPos);
+    AnimationScheduler::Animation animation;
+    animation.target = item;
+    animation.propertyName = "pos";
+    animation.startValue = startPos;
+    animation.endValue = endPos;
     // calculate the duration based on the distance (longer moves take longer animation time)
     double xDist(endPos.x() - startPos.x()), yDist(endPos.y() - startPos.y());
     double distance = (xDist != 0 || yDist != 0) ? qSqrt(xDist * xDist + yDist * yDist) : 0;
-    checkMoveAnimation->setDuration(distance / 400 * 1000 + 200);
-    connect(checkMoveAnimation, &QPropertyAnimation::stateChanged,
-            this, [=](QAbstractAnimation::State newState, QAbstractAnimation::State oldState) {
-        Q_UNUSED(oldState);
-        // when animation starts, add item to scene
-        if (newState == QAbstractAnimation::Running && oldState == QAbstractAnimation::Stopped)
-            addItem(item);
-        // when animation finishes or is stopped, remove item from scene and delete
-        if (newState == QAbstractAnimation::Stopped)
-            removeItem(item);
-    } );
-    // if a piece move animation is running chain this animation so it starts when that finishes
-    // else start it immediately
-    if (itemMoveAnimation && itemMoveAnimation->state() != QAbstractAnimation::Stopped)
-        connect(itemMoveAnimation, &QPropertyAnimation::finished, checkMoveAnimation, [this]() { checkMoveAnimation->start(); } );
-    else
-        checkMoveAnimation->start();
+    animation.duration = distance / 400 * 1000 + 200;
+    animation.afterPly = true;
+    // when animation starts, add item to scene
+    // when animation finishes or is stopped (or is dropped before it starts), remove item from scene and delete
+    animation.onStarted = [this, item]() { addItem(item); };
+    animation.onStopped = [this, item]() { if (item->scene()) removeItem(item); delete item; };
+    animationScheduler->animate(animation);
 }
 
-/*slot*/ void BoardScene::addPiece(int row, int col, const Piece *piece)
+/*slot*/ void BoardScene::addPiece(int row, int col, const Piece &piece)
 {
-    Q_ASSERT(piece);
-    Q_ASSERT(!findItemForPiece(piece));
+    Q_ASSERT(!findItemAt(row, col));
     // get correct pixmap image
-    const QPixmap &pixmap(_pieceImages->piecePixmap(piece->colour, piece->name));
+    const QPixmap &pixmap(_pieceImages->piecePixmap(piece.colour, piece.name));
     // create and add pixmap item to scene
     BoardPiecePixmapItem *item = new BoardPiecePixmapItem;
     item->setPixmap(pixmap);
     addItem(item);
-    // associate item with piece passed in
-    item->piece = piece;
+    // associate item with square and piece passed in
+    setItemAt(row, col, item);
+    item->colour = piece.colour;
+    item->name = piece.name;
     // place at scene position
     int x, y;
     rowColToScenePosForPiece(item, row, col, x, y);
@@ -237,26 +308,30 @@ void BoardScene::animateShowCheck(const QPointF &startPos, const QPointF &endPos
     animateAddPiece(item);
 }
 
-/*slot*/ void BoardScene::removePiece(const Piece *piece)
+/*slot*/ void BoardScene::removePiece(int row, int col)
 {
-    Q_ASSERT(piece);
     // find pixmap item on scene
-    BoardPiecePixmapItem *item = findItemForPiece(piece);
+    BoardPiecePixmapItem *item = findItemAt(row, col);
     Q_ASSERT(item);
+    // dissociate item from square, so a new piece can be added there while this one is animated away
+    squareItems[row][col] = nullptr;
+    item->row = item->col = -1;
 
     // animate flashing piece, when finished remove from scene and delete
     animateRemovePiece(item);
 }
 
-/*slot*/ void BoardScene::movePiece(int row, int col, const Piece *piece)
+/*slot*/ void BoardScene::movePiece(int rowFrom, int colFrom, int rowTo, int colTo)
 {
-    Q_ASSERT(piece);
     // find pixmap item on scene
-    BoardPiecePixmapItem *item = findItemForPiece(piece);
+    BoardPiecePixmapItem *item = findItemAt(rowFrom, colFrom);
     Q_ASSERT(item);
+    // associate item with its new square
+    squareItems[rowFrom][colFrom] = nullptr;
+    setItemAt(rowTo, colTo, item);
     // move to scene position
     int x, y;
-    rowColToScenePosForPiece(item, row, col, x, y);
+    rowColToScenePosForPiece(item, rowTo, colTo, x, y);
 
     // animate the move
     animateMovePiece(item, item->pos(), QPointF(x, y));
@@ -275,18 +350,42 @@ void BoardScene::animateShowCheck(const QPointF &startPos, const QPointF &endPos
 
 /*slot*/ void BoardScene::resetFromModel()
 {
+    // reconcile the pieces on the scene with those in the model in one pass
+    // called after the model has been reset or has made a batch of moves
+    // rather than deleting all items and creating new ones, items already showing the right piece on a square are kept
     // terminate any existing animation
+    // (this also removes any piece being animated away and any check indicator, so the only items left are those in `squareItems`)
     terminateAllAnimations();
     // suspend any animation while resetting board
     suspendAnimation = true;
-    // clear all existing graphics items
-    clear();
-    // query model for all pieces, adding them
-    const Piece *piece;
+    // query model for all pieces, keeping, changing or adding items for them, and deleting items on now empty squares
+    std::optional<Piece> piece;
     for (int row = 0; row < 8; row++)
         for (int col = 0; col < 8; col++)
-            if ((piece = boardModel->pieceAt(row, col)))
-                addPiece(row, col, piece);
+        {
+            BoardPiecePixmapItem *item = squareItems[row][col];
+            piece = boardModel->pieceAt(row, col);
+            if (!piece)
+            {
+                if (item)
+                {
+                    squareItems[row][col] = nullptr;
+                    removeItem(item);
+                    delete item;
+                }
+            }
+            else if (!item)
+                addPiece(row, col, *piece);
+            else if (item->colour != piece->colour || item->name != piece->name)
+            {
+                item->colour = piece->colour;
+                item->name = piece->name;
+                item->setPixmap(_pieceImages->piecePixmap(piece->colour, piece->name));
+                int x, y;
+                rowColToScenePosForPiece(item, row, col, x, y);
+                item->setPos(x, y);
+            }
+        }
     // restore animation
     suspendAnimation = false;
 }
@@ -296,12 +395,12 @@ void BoardScene::redrawAllPieces()
     // redraw all pieces
     // called from `loadPieceImages()`, the piece images and sizes may have changed
     // query model for all pieces, adding them
-    const Piece *piece;
+    std::optional<Piece> piece;
     BoardPiecePixmapItem *item;
     for (int row = 0; row < 8; row++)
         for (int col = 0; col < 8; col++)
             if ((piece = boardModel->pieceAt(row, col)))
-                if ((item = findItemForPiece(piece)))
+                if ((item = findItemAt(row, col)))
                 {
                     // set its pixmap
                     const QPixmap &pixmap(_pieceImages->piecePixmap(piece->colour, piece->name));
@@ -313,20 +412,13 @@ void BoardScene::redrawAllPieces()
                 }
 }
 
-BoardPiecePixmapItem *BoardScene::findItemForPiece(const Piece *piece) const
+void BoardScene::setItemAt(int row, int col, BoardPiecePixmapItem *item)
 {
-    Q_ASSERT(piece);
-    // search all scene items for pixmap item associated with piece passed in
-    QList<QGraphicsItem *> items = this->items();
-    for (QGraphicsItem *item : items)
-    {
-       BoardPiecePixmapItem *pixmapItem = qgraphicsitem_cast<BoardPiecePixmapItem *>(item);
-       if (!pixmapItem)
-           continue;
-       if (pixmapItem->piece == piece)
-           return pixmapItem;
-    }
-    return nullptr;
+    // associate `item` with the square passed in
+    Q_ASSERT(!squareItems[row][col]);
+    squareItems[row][col] = item;
+    item->row = row;
+    item->col = col;
 }
 
 void BoardScene::rowColToScenePos(int row, int col, int &x, int &y) const
@@ -350,6 +442,29 @@ void BoardScene::rowColToScenePosForPiece(const BoardPiecePixmapItem *item, int
     y += (100 - size.height()) / 2;
 }
 
+const QPixmap &BoardScene::boardPixmap(qreal scale)
+{
+    // return the board's squares rendered into a pixmap, `scale` device pixels per scene unit
+    // it is rendered only when first wanted at this scale (e.g. the view has been resized), and reused for every repaint after
+    QSize size(qCeil(800 * scale), qCeil(800 * scale));
+    if (_boardPixmap.size() == size)
+        return _boardPixmap;
+    _boardPixmap = QPixmap(size);
+    // a pixmap starts uninitialised, and when `800 * scale` is fractional its last row & column are not covered by any square
+    _boardPixmap.fill(Qt::gray);
+    QPainter painter(&_boardPixmap);
+    painter.scale(scale, scale);
+    for (int row = 0; row < 8; row++)
+        for (int col = 0; col < 8; col++)
+        {
+            int x, y;
+            rowColToScenePos(row, col, x, y);
+            bool white = ((row + col) & 1);
+            painter.fillRect(QRectF(x, y, 100, 100), white ? Qt::white : Qt::gray);
+        }
+    return _boardPixmap;
+}
+
 /*virtual*/ void BoardScene::drawBackground(QPainter *painter, const QRectF &rect) /*override*/
 {
     // call the base method
@@ -359,17 +474,17 @@ void BoardScene::rowColToScenePosForPiece(const BoardPiecePixmapItem *item, int
     painter->save();
     painter->setClipRect(rect);
 
-    // draw that part of the board which lies in `rect`
-    for (int row = 0; row < 8; row++)
-        for (int col = 0; col < 8; col++)
-        {
-            int x, y;
-            rowColToScenePos(row, col, x, y);
-            QRectF r(x, y, 100, 100);
-            bool white = ((row + col) & 1);
-            if (r.intersects(rect))
-                painter->fillRect(r, QBrush(white ? Qt::white :  Qt::gray, Qt::SolidPattern));
-        }
+    // blit that part of the board which lies in `rect` from the pre-rendered board
+    // at the scale the painter is drawing at, so that the board is as sharp as if it were drawn directly
+    const QRectF boardRect(0, 0, 800, 800);
+    QRectF target(rect & boardRect);
+    if (!target.isEmpty())
+    {
+        qreal scale = qMax(painter->worldTransform().m11(), qreal(0.01)) * painter->device()->devicePixelRatioF();
+        const QPixmap &pixmap(boardPixmap(scale));
+        QRectF source(target.x() * scale, target.y() * scale, target.width() * scale, target.height() * scale);
+        painter->drawPixmap(target, pixmap, source);
+    }
 
     // draw a frame
     painter->drawRect(sceneRect());
@@ -1,8 +1,13 @@
 #ifndef BOARDSCENE_H
 #define BOARDSCENE_H
 
+#include <functional>
+
 #include <QGraphicsPixmapItem>
 #include <QGraphicsScene>
+#include <QHash>
+#include <QList>
+#include <QVariant>
 
 class QPropertyAnimation;
 
@@ -16,7 +21,11 @@ class BoardPiecePixmapItem : public QObject, public QGraphicsPixmapItem
     Q_PROPERTY(int flash READ flashLevel WRITE setFlashLevel)
 
 public:
-    const Piece *piece = nullptr;
+    // the board square the piece is on, -1 once the piece has been removed (while it is animated away)
+    int row = -1, col = -1;
+    // the piece shown, so that `BoardScene::resetFromModel()` can tell whether the item can be kept
+    Piece::PieceColour colour = Piece::White;
+    Piece::PieceName name = Piece::Pawn;
     static constexpr int flashLevelMax = 10;
     int flashLevel() const { return _flashLevel; }
     void setFlashLevel(int level) { _flashLevel = level; setVisible(_flashLevel < flashLevelMax / 2); }
@@ -31,6 +40,60 @@ class BoardSquareRectItem : public QObject, public QGraphicsRectItem
     Q_PROPERTY(QPointF pos READ pos WRITE setPos)
 };
 
+class AnimationScheduler : public QObject
+{
+    // runs the scene's animations, any number at once, each on a `QPropertyAnimation` taken from (and returned to) a pool
+    // the animations started for one ply run together (e.g. King and Rook when castling, pawn and promoted piece),
+    // while those started "after the ply" (e.g. showing check) wait till the others have finished
+    // a ply is everything started in one pass of the event loop, as each move made/undone/redone is
+    // if a ply starts before the previous one's animations have finished they are finished at once,
+    // and later animations are speeded up, so that stepping at any rate never queues up animations behind the board
+    // an animation which "outlives its ply" (e.g. a captured piece flashing away) is not part of this, it runs on through later plies
+    Q_OBJECT
+
+public:
+    AnimationScheduler(QObject *parent = nullptr);
+
+    struct Animation
+    {
+        QObject *target = nullptr;
+        QByteArray propertyName;
+        QVariant startValue, endValue;
+        int duration = 0;           // (ms) at normal speed
+        int loopCount = 1;
+        bool afterPly = false;      // wait till the ply's other animations have finished
+        bool outlivesPly = false;   // neither waited for nor finished early by later plies
+        std::function<void()> onStarted;
+        std::function<void()> onStopped;    // called however the animation stops, even if it never started, to set the final state
+    };
+
+    void animate(const Animation &animation);
+    void finishAnimationsOf(QObject *target);
+    void finishAll();
+
+private:
+    // durations are scaled by `durationScale`, halved each time a ply comes before the last finished, doubled (up to 1) when not
+    static constexpr qreal MinDurationScale = 0.05;
+    struct Running
+    {
+        std::function<void()> onStopped;
+        bool outlivesPly = false;
+    };
+    QList<QPropertyAnimation *> pool;
+    QHash<QPropertyAnimation *, Running> running;
+    int plyAnimationsRunning;   // those in `running` which do not outlive their ply
+    QList<Animation> pending;
+    bool plyOpen;
+    bool finishing;
+    qreal durationScale;
+
+    inline bool plyFinished() const { return plyAnimationsRunning == 0 && pending.isEmpty(); }
+    void beginPly();
+    void finish(bool outlivingPly);
+    void start(const Animation &animation);
+    void stopped(QPropertyAnimation *propertyAnimation);
+};
+
 class BoardScene : public QGraphicsScene
 {
     Q_OBJECT
@@ -45,25 +108,30 @@ public:
     void revertPiecesColour(Piece::PieceColour player);
 
 public slots:
-    void addPiece(int row, int col, const Piece *piece);
-    void removePiece(const Piece *piece);
-    void movePiece(int row, int col, const Piece *piece);
+    void addPiece(int row, int col, const Piece &piece);
+    void removePiece(int row, int col);
+    void movePiece(int rowFrom, int colFrom, int rowTo, int colTo);
     void showCheck(int fromRow, int fromCol, int toRow, int toCol);
     void resetFromModel();
 
 private:
     BoardModel *boardModel;
     PieceImages *_pieceImages;
-    QPropertyAnimation *itemMoveAnimation, *itemFlashAnimation, *checkMoveAnimation;
+    // the piece item on each square, indexed by [row][col], kept in step with the model's signals
+    // (a removed piece which is still being animated away is on no square, so is not in here)
+    BoardPiecePixmapItem *squareItems[8][8];
+    QPixmap _boardPixmap;
+    const QPixmap &boardPixmap(qreal scale);
+    AnimationScheduler *animationScheduler;
     bool doAnimation, suspendAnimation;
-    void terminateAnimation(QPropertyAnimation *&itemAnimation);
     void terminateAllAnimations();
     void animateAddPiece(BoardPiecePixmapItem *item);
     void animateRemovePiece(BoardPiecePixmapItem *item);
     void animateMovePiece(BoardPiecePixmapItem *item, const QPointF &startPos, const QPointF &endPos);
     void animateShowCheck(const QPointF &startPos, const QPointF &endPos);
     void redrawAllPieces();
-    BoardPiecePixmapItem *findItemForPiece(const Piece *piece) const;
+    inline BoardPiecePixmapItem *findItemAt(int row, int col) const { return squareItems[row][col]; }
+    void setItemAt(int row, int col, BoardPiecePixmapItem *item);
     void rowColToScenePos(int row, int col, int &x, int &y) const;
     void rowColToScenePosForPiece(const BoardPiecePixmapItem *item, int row, int col, int &x, int &y) const;
 
@@ -2,5 +2,7 @@
 
 BoardView::BoardView()
 {
-
+    // the board background only changes when the view is resized, so have the view cache it
+    // then repaints for the piece animations just blit it rather than asking the scene to draw it again
+    setCacheMode(QGraphicsView::CacheBackground);
 }
@@ -0,0 +1,9 @@
+# Console program to micro-benchmark the move parser and game file reader
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+include(chessmodel.pri)
+
+SOURCES += \
+    benchmain.cpp
@@ -0,0 +1,38 @@
+# Board model, move parser and headless replay sources
+# shared by the GUI application (chessnotation.pro) and the console programs (chessreplay.pro, chessbench.pro, chessperft.pro, chessthroughput.pro)
+
+QT += core gui concurrent
+# `BoardModel` creates `QAction`s, which live in widgets in Qt 5
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/batchreplayer.cpp \
+    $$PWD/boardmodel.cpp \
+    $$PWD/boardposition.cpp \
+    $$PWD/gameindex.cpp \
+    $$PWD/gamereplayer.cpp \
+    $$PWD/gametokenreader.cpp \
+    $$PWD/movegenerator.cpp \
+    $$PWD/movehistorymodel.cpp \
+    $$PWD/moveparsecache.cpp \
+    $$PWD/movestack.cpp \
+    $$PWD/packedmove.cpp \
+    $$PWD/piece.cpp
+
+HEADERS += \
+    $$PWD/attacktables.h \
+    $$PWD/batchreplayer.h \
+    $$PWD/boardmodel.h \
+    $$PWD/boardposition.h \
+    $$PWD/gameindex.h \
+    $$PWD/gamereplayer.h \
+    $$PWD/gametokenreader.h \
+    $$PWD/movegenerator.h \
+    $$PWD/movehistorymodel.h \
+    $$PWD/moveparsecache.h \
+    $$PWD/movestack.h \
+    $$PWD/packedmove.h \
+    $$PWD/piece.h \
+    $$PWD/zobristkeys.h
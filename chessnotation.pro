@@ -8,26 +8,24 @@ CONFIG += c++17
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+include(chessmodel.pri)
+
 SOURCES += \
-    boardmodel.cpp \
     boardscene.cpp \
     boardview.cpp \
     main.cpp \
     mainwindow.cpp \
-    movehistorymodel.cpp \
-    piece.cpp \
     pieceimages.cpp \
-    piecesetdialog.cpp
+    piecesetdialog.cpp \
+    pixelkernels.cpp
 
 HEADERS += \
-    boardmodel.h \
     boardscene.h \
     boardview.h \
     mainwindow.h \
-    movehistorymodel.h \
-    piece.h \
     pieceimages.h \
-    piecesetdialog.h
+    piecesetdialog.h \
+    pixelkernels.h
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -53,5 +51,6 @@ DISTFILES += \
     samplegames/chernev1 \
     samplegames/chernev2 \
     samplegames/chernev46 \
+    samplegames/chernevgames \
     samplegames/game1 \
     samplegames/game2
@@ -0,0 +1,9 @@
+# Console program to verify and time the move generator by perft (counting the nodes of the legal move tree)
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+include(chessmodel.pri)
+
+SOURCES += \
+    perftmain.cpp
@@ -0,0 +1,9 @@
+# Console program to replay/validate game files without any GUI
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+include(chessmodel.pri)
+
+SOURCES += \
+    replaymain.cpp
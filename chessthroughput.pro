@@ -0,0 +1,9 @@
+# Console program to benchmark whole-game replay throughput through the board model
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+include(chessmodel.pri)
+
+SOURCES += \
+    throughputmain.cpp
@@ -0,0 +1,157 @@
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include "gameindex.h"
+#include "gametokenreader.h"
+
+GameIndex::GameIndex()
+{
+}
+
+void GameIndex::build(QIODevice *device)
+{
+    // scan `device`, from its current position to its end, for where each game starts and ends
+    // a game starts at a header line (first non-blank character is `[`) which follows a previous game's moves
+    // this only looks at the start of each line, games' moves are not tokenized
+    entries.clear();
+    char line[4096];
+    qint64 pos = device->pos(), length;
+    qint64 gameStart = pos, gameEnd = pos;
+    bool atLineStart = true, inHeaders = false, gameHasContent = false;
+    while ((length = device->readLine(line, sizeof(line))) > 0)
+    {
+        // a line longer than `line` is read in pieces, only the first piece is at the start of the line
+        // a byte order mark at the start of the device is skipped, else it would hide a first header line
+        int i = (pos == 0) ? GameTokenReader::byteOrderMarkLength(line, length) : 0;
+        while (i < length && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r' || line[i] == '\n'))
+            i++;
+        if (i < length)
+        {
+            if (atLineStart)
+            {
+                bool isHeader = (line[i] == '[');
+                if (isHeader && !inHeaders && gameHasContent)
+                {
+                    // headers after moves start the next game
+                    entries.append({ gameStart, gameEnd });
+                    gameStart = pos;
+                }
+                inHeaders = isHeader;
+            }
+            gameHasContent = true;
+            gameEnd = pos + length;
+        }
+        atLineStart = (line[length - 1] == '\n');
+        pos += length;
+    }
+    // a file without any games is still one (empty) game
+    if (gameHasContent || entries.isEmpty())
+        entries.append({ gameStart, gameHasContent ? gameEnd : pos });
+}
+
+bool GameIndex::open(const QString &filePath, QString *errorMessage /*= nullptr*/)
+{
+    // fill the index for the game file at `filePath`
+    // use its index file if that is up to date, else scan the game file and (if it holds more than one game) save an index file
+    QFileInfo fileInfo(filePath);
+    qint64 fileSize = fileInfo.size();
+    qint64 fileLastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+    const QString indexPath = indexFilePath(filePath);
+    if (load(indexPath, fileSize, fileLastModified))
+        return true;
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        if (errorMessage)
+            *errorMessage = QString("%1: %2").arg(file.fileName()).arg(file.errorString());
+        return false;
+    }
+    build(&file);
+    file.close();
+    // failing to save (e.g. a read-only directory) only means the index is built again next time
+    if (count() > 1)
+        save(indexPath, fileSize, fileLastModified);
+    return true;
+}
+
+bool GameIndex::load(const QString &indexFilePath, qint64 fileSize, qint64 fileLastModified)
+{
+    // load the index from `indexFilePath`
+    // return false => no index file, or it is not for a game file of `fileSize` last modified at `fileLastModified`
+    QFile file(indexFilePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream ds(&file);
+    quint32 magic;
+    quint16 version;
+    qint64 size, lastModified;
+    qint32 entryCount;
+    ds >> magic >> version >> size >> lastModified >> entryCount;
+    if (ds.status() != QDataStream::Ok || magic != IndexFileMagic || version != IndexFileVersion)
+        return false;
+    if (size != fileSize || lastModified != fileLastModified || entryCount < 0)
+        return false;
+
+    QList<Entry> loaded;
+    loaded.reserve(entryCount);
+    for (int i = 0; i < entryCount; i++)
+    {
+        Entry entry;
+        ds >> entry.pos >> entry.endPos;
+        loaded.append(entry);
+    }
+    if (ds.status() != QDataStream::Ok)
+        return false;
+    entries = loaded;
+    return true;
+}
+
+bool GameIndex::save(const QString &indexFilePath, qint64 fileSize, qint64 fileLastModified) const
+{
+    // save the index to `indexFilePath`, recording the size and last modified time of the game file it is for
+    QSaveFile file(indexFilePath);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream ds(&file);
+    ds << IndexFileMagic << IndexFileVersion << fileSize << fileLastModified << qint32(entries.count());
+    for (const Entry &entry : entries)
+        ds << entry.pos << entry.endPos;
+    return file.commit();
+}
+
+/*static*/ QString GameIndex::indexFilePath(const QString &filePath)
+{
+    // return the path of the index file kept alongside the game file at `filePath`
+    return filePath + ".index";
+}
+
+/*static*/ bool GameIndex::isIndexFilePath(const QString &filePath)
+{
+    // return whether `filePath` is an index file rather than a game file
+    return filePath.endsWith(".index");
+}
+
+/*static*/ QStringList GameIndex::expandFilePaths(const QStringList &paths)
+{
+    // return the game files named by `paths`, a directory meaning every file in it other than index files
+    QStringList filePaths;
+    for (const QString &path : paths)
+    {
+        QFileInfo fileInfo(path);
+        if (fileInfo.isDir())
+        {
+            QDir dir(path);
+            for (const QString &fileName : dir.entryList(QDir::Files, QDir::Name))
+                if (!isIndexFilePath(fileName))
+                    filePaths << dir.filePath(fileName);
+        }
+        else
+            filePaths << path;
+    }
+    return filePaths;
+}
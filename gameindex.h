@@ -0,0 +1,42 @@
+#ifndef GAMEINDEX_H
+#define GAMEINDEX_H
+
+#include <QIODevice>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// an index of where each game is in a game file
+// a file holds either a single game, just its moves as in `samplegames/`,
+// or many games, each starting with PGN-like header lines such as `[Event "..."]` followed by its descriptive moves
+class GameIndex
+{
+public:
+    GameIndex();
+
+    struct Entry
+    {
+        qint64 pos;      // byte offset of the start of the game (its first header line)
+        qint64 endPos;   // byte offset just beyond the end of the game's moves
+    };
+
+    inline int count() const { return entries.count(); }
+    inline const Entry &at(int i) const { return entries.at(i); }
+
+    void build(QIODevice *device);
+    bool open(const QString &filePath, QString *errorMessage = nullptr);
+    bool load(const QString &indexFilePath, qint64 fileSize, qint64 fileLastModified);
+    bool save(const QString &indexFilePath, qint64 fileSize, qint64 fileLastModified) const;
+
+    static QString indexFilePath(const QString &filePath);
+    static bool isIndexFilePath(const QString &filePath);
+    static QStringList expandFilePaths(const QStringList &paths);
+
+private:
+    // an index file is only written for files holding more than one game
+    static constexpr quint32 IndexFileMagic = 0x43484749;    // "CHGI"
+    static constexpr quint16 IndexFileVersion = 1;
+    QList<Entry> entries;
+};
+
+#endif // GAMEINDEX_H
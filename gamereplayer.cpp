@@ -0,0 +1,121 @@
+#include <QFile>
+
+#include "gamereplayer.h"
+#include "gametokenreader.h"
+
+GameReplayer::GameReplayer()
+{
+}
+
+/*static*/ QStringList GameReplayer::readTokens(QIODevice *device, qint64 endPos /*= -1*/)
+{
+    // read all of a game's move tokens from `device`, up to `endPos` (-1 => the end), turn numbers removed
+    QStringList tokens;
+    GameTokenReader tokenReader(device, endPos);
+    QString token;
+    while (tokenReader.readToken(token))
+        tokens << token;
+    return tokens;
+}
+
+/*static*/ GameReplayer::ResolvedMoves GameReplayer::resolveMoves(BoardPosition position, Piece::PieceColour player, const QStringList &tokens, int firstTokenIndex /*= 0*/,
+                                                                std::atomic<int> *tokensResolved /*= nullptr*/, const std::atomic<bool> *cancelled /*= nullptr*/)
+{
+    // resolve the tokens from `firstTokenIndex` on into packed moves, starting from `position` with `player` to move
+    // this works on its own copy of the position, touching no `BoardModel`, so it can be run on a worker thread
+    // `*tokensResolved` (if passed) is kept up to date for progress, and setting `*cancelled` (if passed) stops it
+    // stop at the first token which fails, and report it in the result, the moves resolved before it are kept
+    ResolvedMoves resolved;
+    resolved.moves.reserve(tokens.count() - firstTokenIndex);
+    for (int i = firstTokenIndex; i < tokens.count(); i++)
+    {
+        if (cancelled && *cancelled)
+        {
+            resolved.result.message = "Cancelled";
+            return resolved;
+        }
+        MoveParser mp(&position, player);
+        QList<MoveParser::ParsedMove> moves;
+        if (!mp.parse(tokens.at(i), moves))
+        {
+            // as in `BoardModel::replayMove()`, only on failure connect and re-parse to collect the parser's message
+            QString &message(resolved.result.message);
+            QObject::connect(&mp, &MoveParser::parserMessage, [&message](const QString &msg) { message = msg; });
+            mp.parse(tokens.at(i), moves);
+            resolved.result.failedTokenIndex = i;
+            resolved.result.failedToken = tokens.at(i);
+            return resolved;
+        }
+        PackedMove move(mp.packMoves(moves));
+        move.make(position);
+        resolved.moves.append(move);
+        resolved.result.movesMade++;
+        player = Piece::opposingColour(player);
+        if (tokensResolved)
+            *tokensResolved = resolved.result.movesMade;
+    }
+    resolved.result.success = true;
+    return resolved;
+}
+
+GameReplayer::Result GameReplayer::replay(const QStringList &tokens)
+{
+    // replay a whole game, one token per move with white moving first, starting from a new game
+    // this drives `BoardModel::replayMove()` directly, so there are no undo commands, move history or animations
+    // stop at the first token which fails, and report it in the result
+    Result result;
+    _boardModel.newGame();
+    Piece::PieceColour player = Piece::White;
+    for (int i = 0; i < tokens.count(); i++)
+    {
+        if (!_boardModel.replayMove(player, tokens.at(i), &result.message))
+        {
+            result.failedTokenIndex = i;
+            result.failedToken = tokens.at(i);
+            return result;
+        }
+        result.movesMade++;
+        player = Piece::opposingColour(player);
+    }
+    result.success = true;
+    return result;
+}
+
+GameReplayer::Result GameReplayer::replay(QIODevice *device, qint64 endPos /*= -1*/)
+{
+    // replay a whole game read from `device`, up to `endPos` (-1 => the end), starting from a new game
+    // tokens are read as they are replayed, so the game is never held in memory in full
+    Result result;
+    _boardModel.newGame();
+    Piece::PieceColour player = Piece::White;
+    GameTokenReader tokenReader(device, endPos);
+    QString token;
+    for (int i = 0; tokenReader.readToken(token); i++)
+    {
+        if (!_boardModel.replayMove(player, token, &result.message))
+        {
+            result.failedTokenIndex = i;
+            result.failedToken = token;
+            return result;
+        }
+        result.movesMade++;
+        player = Piece::opposingColour(player);
+    }
+    result.success = true;
+    return result;
+}
+
+GameReplayer::Result GameReplayer::replayFile(const QString &filePath)
+{
+    // replay a whole game read from the file at `filePath`
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        Result result;
+        result.message = QString("%1: %2").arg(file.fileName()).arg(file.errorString());
+        return result;
+    }
+    Result result = replay(&file);
+    file.close();
+    return result;
+}
@@ -0,0 +1,46 @@
+#ifndef GAMEREPLAYER_H
+#define GAMEREPLAYER_H
+
+#include <atomic>
+
+#include <QIODevice>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "boardmodel.h"
+
+class GameReplayer
+{
+public:
+    GameReplayer();
+
+    struct Result
+    {
+        bool success = false;
+        int movesMade = 0;
+        int failedTokenIndex = -1;
+        QString failedToken;
+        QString message;
+    };
+    struct ResolvedMoves
+    {
+        Result result;
+        QVector<PackedMove> moves;
+    };
+
+    static QStringList readTokens(QIODevice *device, qint64 endPos = -1);
+    static ResolvedMoves resolveMoves(BoardPosition position, Piece::PieceColour player, const QStringList &tokens, int firstTokenIndex = 0,
+                                      std::atomic<int> *tokensResolved = nullptr, const std::atomic<bool> *cancelled = nullptr);
+    Result replay(const QStringList &tokens);
+    Result replay(QIODevice *device, qint64 endPos = -1);
+    Result replayFile(const QString &filePath);
+    inline const BoardModel &boardModel() const { return _boardModel; }
+    // an optional cache of resolved moves, shared by all the games this replays (not owned)
+    inline void setMoveParseCache(MoveParseCache *cache) { _boardModel.setMoveParseCache(cache); }
+
+private:
+    BoardModel _boardModel;
+};
+
+#endif // GAMEREPLAYER_H
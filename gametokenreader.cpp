@@ -0,0 +1,115 @@
+#include "gametokenreader.h"
+
+GameTokenReader::GameTokenReader(QIODevice *device, qint64 endPos /*= -1*/)
+{
+    // read move tokens from `device`, which must already be open for read, starting at its current position
+    // and stopping at `endPos` (-1 => the end of the device), e.g. one game's range from a `GameIndex`
+    this->device = device;
+    this->endPos = endPos;
+    bufferPos = 0;
+    bufferDevicePos = device->pos();
+    _tokenPos = -1;
+    _tokensRead = 0;
+}
+
+bool GameTokenReader::readToken(QString &token)
+{
+    // read the next move token from the device, tokens are separated by any whitespace
+    // a turn number (like "12" or "12.") before a white move is skipped
+    // so are header tags (like `[Event "..."]`) and a game result (like "1-0") in a multi-game file
+    // return true => `token` set to the move, and `tokenPos()` to its position in the device
+    // return false => no more tokens
+    while (readWord())
+    {
+        if (_tokensRead % 2 == 0 && isTurnNumber(word.constData(), word.length()))
+            continue;
+        if (word.startsWith('['))
+        {
+            // skip words up to the end of the tag, its value may contain spaces
+            while (!word.endsWith(']') && readWord())
+                ;
+            continue;
+        }
+        if (isGameResult(word.constData(), word.length()))
+            continue;
+        token = QString::fromUtf8(word);
+        _tokensRead++;
+        return true;
+    }
+    return false;
+}
+
+/*static*/ bool GameTokenReader::isTurnNumber(const char *word, int length)
+{
+    // return whether a word is a turn number, one or more digits with an optional trailing "."
+    if (length > 0 && word[length - 1] == '.')
+        length--;
+    if (length == 0)
+        return false;
+    for (int i = 0; i < length; i++)
+        if (word[i] < '0' || word[i] > '9')
+            return false;
+    return true;
+}
+
+/*static*/ bool GameTokenReader::isGameResult(const char *word, int length)
+{
+    // return whether a word is a game result, "1-0", "0-1", "1/2-1/2" or "*"
+    // (castling may be written "0-0", so that is not a result)
+    QByteArray result = QByteArray::fromRawData(word, length);
+    return result == "1-0" || result == "0-1" || result == "1/2-1/2" || result == "*";
+}
+
+/*static*/ int GameTokenReader::byteOrderMarkLength(const char *data, int length)
+{
+    // return the length of a UTF-8 byte order mark (EF BB BF) at the start of `data`, 0 => none
+    // (`QTextStream` skips one at the start of a file, so reading bytes directly must too)
+    return (length >= 3 && data[0] == '\xEF' && data[1] == '\xBB' && data[2] == '\xBF') ? 3 : 0;
+}
+
+bool GameTokenReader::fillBuffer()
+{
+    // read the next chunk from the device into `buffer`, not reading beyond `endPos`
+    // return false => no more data
+    bufferDevicePos = device->pos();
+    qint64 chunkSize = ChunkSize;
+    if (endPos >= 0)
+        chunkSize = qBound(qint64(0), endPos - bufferDevicePos, chunkSize);
+    buffer.resize(chunkSize);
+    qint64 bytesRead = device->read(buffer.data(), chunkSize);
+    buffer.resize(qMax(bytesRead, qint64(0)));
+    bufferPos = 0;
+    // skip a byte order mark at the start of the device
+    if (bufferDevicePos == 0)
+        bufferPos = byteOrderMarkLength(buffer.constData(), buffer.size());
+    return bufferPos < buffer.size();
+}
+
+bool GameTokenReader::readWord()
+{
+    // read the next whitespace-separated word into `word`, which may span chunks
+    // return false => no more words
+    word.clear();
+    for (;;)
+    {
+        if (bufferPos >= buffer.size() && !fillBuffer())
+            return !word.isEmpty();
+        const char *data = buffer.constData();
+        int size = buffer.size();
+        if (word.isEmpty())
+        {
+            // skip whitespace before the word
+            while (bufferPos < size && isSpace(data[bufferPos]))
+                bufferPos++;
+            if (bufferPos >= size)
+                continue;
+            _tokenPos = bufferDevicePos + bufferPos;
+        }
+        int start = bufferPos;
+        while (bufferPos < size && !isSpace(data[bufferPos]))
+            bufferPos++;
+        word.append(data + start, bufferPos - start);
+        if (bufferPos < size)
+            return true;
+    }
+}
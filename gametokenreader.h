@@ -0,0 +1,38 @@
+#ifndef GAMETOKENREADER_H
+#define GAMETOKENREADER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+
+class GameTokenReader
+{
+public:
+    GameTokenReader(QIODevice *device, qint64 endPos = -1);
+
+    bool readToken(QString &token);
+    inline qint64 tokenPos() const { return _tokenPos; }
+    inline int tokensRead() const { return _tokensRead; }
+
+    static bool isTurnNumber(const char *word, int length);
+    static bool isGameResult(const char *word, int length);
+    static int byteOrderMarkLength(const char *data, int length);
+
+private:
+    // the device is read in chunks of this many bytes, so memory use does not depend on its size
+    enum { ChunkSize = 64 * 1024 };
+    QIODevice *device;
+    qint64 endPos;
+    QByteArray buffer;
+    int bufferPos;
+    qint64 bufferDevicePos;
+    QByteArray word;
+    qint64 _tokenPos;
+    int _tokensRead;
+
+    bool fillBuffer();
+    bool readWord();
+    static inline bool isSpace(char ch) { return ch == ' ' || (ch >= '\t' && ch <= '\r'); }
+};
+
+#endif // GAMETOKENREADER_H
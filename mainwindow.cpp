@@ -1,3 +1,4 @@
+#include <QActionGroup>
 #include <QApplication>
 #include <QBoxLayout>
 #include <QDebug>
@@ -5,21 +6,27 @@
 #include <QFileDialog>
 #include <QFrame>
 #include <QHeaderView>
+#include <QInputDialog>
 #include <QKeyEvent>
 #include <QLabel>
 #include <QLineEdit>
 #include <QMenu>
 #include <QMenuBar>
 #include <QMessageBox>
+#include <QProgressDialog>
 #include <QPushButton>
-#include <QRegularExpression>
 #include <QTableView>
 #include <QTextStream>
 #include <QToolButton>
+#include <QtConcurrent>
 
 #include "boardmodel.h"
 #include "boardscene.h"
 #include "boardview.h"
+#include "gameindex.h"
+#include "gamereplayer.h"
+#include "moveparsecache.h"
+#include "pieceimages.h"
 #include "piecesetdialog.h"
 #include "mainwindow.h"
 
@@ -30,6 +37,9 @@ MainWindow::MainWindow(QWidget *parent)
 
     // create the board model
     this->boardModel = new BoardModel(this);
+    // cache resolved moves, so that restarting or re-opening a game does not re-resolve them
+    this->moveParseCache = new MoveParseCache;
+    boardModel->setMoveParseCache(moveParseCache);
     // create the graphics scene
     this->boardScene = new BoardScene(boardModel, this);
 
@@ -44,6 +54,7 @@ MainWindow::MainWindow(QWidget *parent)
     MoveHistoryModel *moveHistoryModel(boardModel->moveHistoryModel());
     connect(moveHistoryModel, &MoveHistoryModel::moveAppended, moveHistoryView, &QTableView::scrollToBottom);
     connect(moveHistoryModel, &MoveHistoryModel::lastMoveRemoved, moveHistoryView, &QTableView::scrollToBottom);
+    connect(moveHistoryModel, &MoveHistoryModel::modelReset, moveHistoryView, &QTableView::scrollToBottom);
     connect(openedGameRunner, &OpenedGameRunner::stepOneMove, this, &MainWindow::stepOneMove);
     connect(undoAction, &QAction::triggered, openedGameRunner, &OpenedGameRunner::runStepTimerStop);
 
@@ -53,6 +64,8 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    boardModel->setMoveParseCache(nullptr);
+    delete moveParseCache;
 }
 
 const QString MainWindow::appRootPath()
@@ -105,8 +118,14 @@ void MainWindow::setupUi()
     mainMenu->addAction("Exit", qApp, &QApplication::quit);
 
     // load the pieces
+    // the other piece sets are decoded in the background, so that choosing one later is immediate
     const QString dirPath = appRootPath() + "/images/piece_set_1";
     boardScene->loadPieceImages(dirPath);
+    QDir imagesDir(appRootPath() + "/images");
+    QStringList pieceSetDirPaths;
+    for (const QString &dirName : imagesDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name))
+        pieceSetDirPaths << imagesDir.filePath(dirName);
+    PieceImages::preloadPieceSets(pieceSetDirPaths);
 
     boardScene->setSceneRect(0, 0, 800, 800);
     // create the graphics view, as left-hand pane
@@ -253,19 +272,38 @@ bool MainWindow::parseAndMakeMove(const QString &text)
     QString filePath = QFileDialog::getOpenFileName(this, "Open File", dirPath);
     if (filePath.isEmpty())
         return;
+    // index where the games are in the file (an up-to-date index file is used if there is one)
+    GameIndex gameIndex;
+    QString errorMessage;
+    if (!gameIndex.open(filePath, &errorMessage))
+    {
+        QMessageBox::information(this, "Failed to Open File", errorMessage);
+        return;
+    }
     QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    if (!file.open(QIODevice::ReadOnly))
     {
         QMessageBox::information(this, "Failed to Open File", QString("%1: %2").arg(file.fileName()).arg(file.errorString()));
         return;
     }
 
+    // if the file holds more than one game ask which one to open
+    int gameNumber = 1;
+    if (gameIndex.count() > 1)
+    {
+        bool ok;
+        gameNumber = QInputDialog::getInt(this, "Open Game", QString("Game number (1-%1):").arg(gameIndex.count()), 1, 1, gameIndex.count(), 1, &ok);
+        if (!ok)
+            return;
+    }
+    const GameIndex::Entry &entry(gameIndex.at(gameNumber - 1));
+
     // start a new game
     actionNewGame();
 
-    // get `openedGameRunner` to read the file, splitting into tokens
-    QTextStream ts(&file);
-    openedGameRunner->readFile(ts);
+    // get `openedGameRunner` to read the game from the file, splitting into tokens
+    file.seek(entry.pos);
+    openedGameRunner->readFile(&file, entry.endPos);
     file.close();
 }
 
@@ -375,7 +413,9 @@ OpenedGameRunner::OpenedGameRunner(QMenu *runMenu, QFrame *runButtonsFrame, Boar
     setupUi();
 
     connect(boardModel, &BoardModel::undoStackIndexChanged, this, &OpenedGameRunner::updateMenuEnablement);
-    connect(&runStepTimer, &QTimer::timeout, this, &OpenedGameRunner::actionStep);
+    connect(&runStepTimer, &QTimer::timeout, this, &OpenedGameRunner::runStepTimerTimeout);
+    connect(&runToEndWatcher, &QFutureWatcher<GameReplayer::ResolvedMoves>::finished, this, &OpenedGameRunner::runToEndFinished);
+    connect(&runToEndProgressTimer, &QTimer::timeout, this, &OpenedGameRunner::runToEndProgress);
 }
 
 void OpenedGameRunner::setupUi()
@@ -387,6 +427,25 @@ void OpenedGameRunner::setupUi()
     runPauseAction = runMenu->addAction(style.standardIcon(QStyle::SP_MediaPlay), "Run", Qt::Key_Space, this, &OpenedGameRunner::actionRunPause);
     runToEndAction = runMenu->addAction(style.standardIcon(QStyle::SP_MediaSkipForward), "Run to End", this, &OpenedGameRunner::actionRunToEnd);
     returnToReachedAction = runMenu->addAction("Return to Reached", this, &OpenedGameRunner::actionReturnToReached);
+    // the "Run Speed" submenu, one checkable action per speed, its data being the plies per second
+    runSpeedMenu = runMenu->addMenu("Run Speed");
+    runSpeedActionGroup = new QActionGroup(this);
+    const struct { const char *text; int pliesPerSecond; } runSpeeds[] =
+    {
+        { "1 move/s", 1 }, { "2 moves/s", 2 }, { "4 moves/s", 4 },
+        { "10 moves/s", 10 }, { "50 moves/s", 50 }, { "As fast as possible", 0 },
+    };
+    for (const auto &runSpeed : runSpeeds)
+    {
+        QAction *action = runSpeedMenu->addAction(runSpeed.text);
+        action->setCheckable(true);
+        action->setData(runSpeed.pliesPerSecond);
+        runSpeedActionGroup->addAction(action);
+    }
+    runSpeedActionGroup->actions().first()->setChecked(true);
+    runPliesPerSecond = 1;
+    runningBatched = false;
+    connect(runSpeedActionGroup, &QActionGroup::triggered, this, &OpenedGameRunner::actionRunSpeed);
     // and the corresponding buttons in `runButtonsFrame`
     runButtonsFrame->setLayout(new QHBoxLayout);
     for (QAction *action : { restartAction, stepAction, runPauseAction, runToEndAction, /*returnToReachedAction*/ } )
@@ -396,13 +455,31 @@ void OpenedGameRunner::setupUi()
         btn->setDefaultAction(action);
         runButtonsFrame->layout()->addWidget(btn);
     }
+    // a button popping up the "Run Speed" submenu
+    QToolButton *btn = new QToolButton();
+    btn->setMinimumWidth(30);
+    btn->setText("Speed");
+    btn->setToolTip("Run Speed");
+    btn->setMenu(runSpeedMenu);
+    btn->setPopupMode(QToolButton::InstantPopup);
+    runButtonsFrame->layout()->addWidget(btn);
+    // the progress dialog for "Run to End", only shown if it takes a while
+    runToEndProgressDialog = new QProgressDialog("Running to end...", "Cancel", 0, 0, qobject_cast<QWidget *>(parent()));
+    runToEndProgressDialog->setWindowTitle("Run to End");
+    runToEndProgressDialog->setWindowModality(Qt::WindowModal);
+    runToEndProgressDialog->setMinimumDuration(500);
+    runToEndProgressDialog->setAutoReset(false);
+    runToEndProgressDialog->reset();
+    connect(runToEndProgressDialog, &QProgressDialog::canceled, this, [this]() { if (runToEndJob) runToEndJob->cancelled = true; });
     clear();
 }
 
 /*slot*/ void OpenedGameRunner::updateMenuEnablement()
 {
     // enable/disable menu items corresponding to current state
-    runMenu->setEnabled(allTokens.count() > 0);
+    // while "Run to End" is resolving moves nothing else can be done
+    runMenu->setEnabled(allTokens.count() > 0 && !runToEndWatcher.isRunning());
+    runButtonsFrame->setEnabled(!runToEndWatcher.isRunning());
     runPauseAction->setText(runStepTimer.isActive() ? "Pause" : "Run");
     runPauseAction->setIcon(runMenu->style()->standardIcon(runStepTimer.isActive() ? QStyle::SP_MediaPause : QStyle::SP_MediaPlay));
     // we can only "continue" making moves if not at the end of moves and have not changed state since the last move was made
@@ -415,16 +492,11 @@ void OpenedGameRunner::setupUi()
     returnToReachedAction->setEnabled(boardModel->undoStackCanRestoreToClean());
 }
 
-void OpenedGameRunner::readFile(QTextStream &ts)
+void OpenedGameRunner::readFile(QIODevice *device, qint64 endPos /*= -1*/)
 {
-    // read the file content, split into tokens on any whitespace
+    // read the file content, up to `endPos` (-1 => the end), split into tokens on any whitespace
     runStepTimer.stop();
-    QString fileContent = ts.readAll();
-    this->allTokens = fileContent.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
-    // if there is a turn number before white moves remove it
-    for (int i = 0; i < allTokens.count(); i++)
-        if (i % 2 == 0 && allTokens.at(i).contains(QRegularExpression("^\\d+\\.?$")))
-            allTokens.removeAt(i--);
+    this->allTokens = GameReplayer::readTokens(device, endPos);
     currentTokenIndex = 0;
     updateMenuEnablement();
 }
@@ -468,6 +540,8 @@ bool OpenedGameRunner::doStepOneMove()
 {
     // clear any opened game
     runStepTimer.stop();
+    if (runToEndJob)
+        runToEndJob->cancelled = true;
     allTokens.clear();
     currentTokenIndex = 0;
     updateMenuEnablement();
@@ -476,6 +550,8 @@ bool OpenedGameRunner::doStepOneMove()
 /*slot*/ void OpenedGameRunner::actionRestart()
 {
     runStepTimer.stop();
+    if (runToEndJob)
+        runToEndJob->cancelled = true;
     boardModel->newGame();
     currentTokenIndex = 0;
     updateMenuEnablement();
@@ -493,25 +569,133 @@ bool OpenedGameRunner::doStepOneMove()
     updateMenuEnablement();
 }
 
+void OpenedGameRunner::startRunning(int pliesPerSecond)
+{
+    // start `runStepTimer` making plies at `pliesPerSecond` (0 => as fast as possible)
+    // slow enough speeds step one ply per timeout, animating it
+    // faster ones make however many plies are due per frame, in a batch
+    runPliesMade = 0;
+    runElapsedTimer.start();
+    runningBatched = !(pliesPerSecond > 0 && pliesPerSecond <= MaxAnimatedPliesPerSecond);
+    runStepTimer.start(runningBatched ? FrameInterval : 1000 / pliesPerSecond);
+}
+
+void OpenedGameRunner::runBatchedPlies(int pliesPerSecond)
+{
+    // make the plies due since `startRunning()` at `pliesPerSecond` (0 => as many as fit in `RunTimeSlice`)
+    // they are made in a batch, so the board is redrawn once for all of them, without animation
+    // never spending more than `RunTimeSlice` here keeps the window responsive however fast the speed
+    int due = (pliesPerSecond > 0) ? int(runElapsedTimer.elapsed() * pliesPerSecond / 1000) - runPliesMade : allTokens.count();
+    if (due <= 0)
+        return;
+    QElapsedTimer sliceTimer;
+    sliceTimer.start();
+    boardModel->beginMoveBatch();
+    while (due > 0 && currentTokenIndex < allTokens.count() && sliceTimer.elapsed() < RunTimeSlice)
+    {
+        if (!doStepOneMove())
+        {
+            runStepTimer.stop();
+            break;
+        }
+        due--;
+        runPliesMade++;
+    }
+    boardModel->endMoveBatch();
+}
+
+/*slot*/ void OpenedGameRunner::runStepTimerTimeout()
+{
+    // slot for `runStepTimer` timing out while running
+    // if the user has made/undone moves in the meantime the opened game cannot be continued
+    if (currentTokenIndex >= allTokens.count() || !boardModel->undoStackIsClean())
+        runStepTimer.stop();
+    else if (!runningBatched)
+    {
+        actionStep();
+        return;
+    }
+    else
+        runBatchedPlies(runPliesPerSecond);
+    if (currentTokenIndex >= allTokens.count())
+        runStepTimer.stop();
+    updateMenuEnablement();
+}
+
 /*slot*/ void OpenedGameRunner::actionRunPause()
 {
     // toggle whether `runStepTimer` is running or stopped
     if (runStepTimer.isActive())
         runStepTimer.stop();
     else
-        runStepTimer.start(1000);
+    {
+        startRunning(runPliesPerSecond);
+    }
     updateMenuEnablement();
 }
 
+/*slot*/ void OpenedGameRunner::actionRunSpeed(QAction *action)
+{
+    // action for the "Run Speed" submenu
+    // if running, carry on at the new speed
+    runPliesPerSecond = action->data().toInt();
+    if (runStepTimer.isActive())
+        startRunning(runPliesPerSecond);
+}
+
 /*slot*/ void OpenedGameRunner::actionRunToEnd()
 {
-    // repeatedly emit the `stepOneMove()` signal
-    // till we reach the end, or a move fails
+    // run to the end, or till a move fails
+    // rather than stepping each move on the GUI thread, the remaining tokens are parsed & resolved on a worker thread,
+    // from a copy of the current position, with a (cancellable) progress dialog shown if that takes a while
+    // `runToEndFinished()` then makes all the moves resolved in one batch
+    if (runToEndWatcher.isRunning() || currentTokenIndex >= allTokens.count())
+        return;
     runStepTimer.stop();
+    std::shared_ptr<RunToEndJob> job(std::make_shared<RunToEndJob>());
+    job->startKey = boardModel->positionKey();
+    this->runToEndJob = job;
+    BoardPosition position(boardModel->position());
+    Piece::PieceColour player(boardModel->moveHistoryModel()->playerToMove());
+    QStringList tokens(allTokens);
+    int firstTokenIndex = currentTokenIndex;
+    // the worker shares only `job` and its own copies, so it is safe however long it outlives the request
+    runToEndWatcher.setFuture(QtConcurrent::run([job, position, player, tokens, firstTokenIndex]() {
+        return GameReplayer::resolveMoves(position, player, tokens, firstTokenIndex, &job->tokensResolved, &job->cancelled);
+    } ));
+    runToEndProgressDialog->setRange(0, allTokens.count() - currentTokenIndex);
+    runToEndProgressDialog->setValue(0);
+    runToEndProgressTimer.start(100);
     updateMenuEnablement();
-    while (currentTokenIndex < allTokens.count())
-        if (!doStepOneMove())
-            break;
+}
+
+/*slot*/ void OpenedGameRunner::runToEndProgress()
+{
+    // slot for `runToEndProgressTimer`, show how far "Run to End" has got
+    // (the progress dialog only appears once this has been called after its minimum duration)
+    if (runToEndJob && !runToEndProgressDialog->wasCanceled())
+        runToEndProgressDialog->setValue(runToEndJob->tokensResolved);
+}
+
+/*slot*/ void OpenedGameRunner::runToEndFinished()
+{
+    // slot for "Run to End"'s worker finishing
+    // make the moves it resolved, in one batch, so the board & move history are updated just once
+    // if a token failed make it as stepping would, so that the user is shown the failing move & the parser's message
+    // nothing is made if cancelled, or if the board has been changed meanwhile
+    runToEndProgressTimer.stop();
+    runToEndProgressDialog->reset();
+    std::shared_ptr<RunToEndJob> job(runToEndJob);
+    runToEndJob.reset();
+    GameReplayer::ResolvedMoves resolved(runToEndWatcher.result());
+    if (job && !job->cancelled && boardModel->positionKey() == job->startKey && boardModel->undoStackIsClean())
+    {
+        boardModel->makeMoves(resolved.moves);
+        currentTokenIndex += resolved.moves.count();
+        boardModel->undoStackSetClean();
+        if (!resolved.result.success && currentTokenIndex < allTokens.count())
+            doStepOneMove();
+    }
     updateMenuEnablement();
 }
 
@@ -1,22 +1,30 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <memory>
+
+#include <QElapsedTimer>
+#include <QFutureWatcher>
 #include <QLineEdit>
 #include <QMainWindow>
 #include <QTextStream>
 #include <QTimer>
 
+class QActionGroup;
 class QFrame;
 class QHBoxLayout;
 class QLabel;
+class QProgressDialog;
 class QSpacerItem;
 class QTableView;
 
+#include "gamereplayer.h"
 #include "piece.h"
 
 class BoardModel;
 class BoardScene;
 class EnterMoveLineEdit;
+class MoveParseCache;
 class OpenedGameRunner;
 
 class MainWindow : public QMainWindow
@@ -29,6 +37,7 @@ public:
 
 private:
     BoardModel *boardModel;
+    MoveParseCache *moveParseCache;
     BoardScene *boardScene;
     QTableView *moveHistoryView;
     QHBoxLayout *hblytEnterMove;
@@ -75,7 +84,7 @@ public:
     OpenedGameRunner(QMenu *runMenu, QFrame *runButtonsFrame, BoardModel *boardModel, QWidget *parent = nullptr);
 
     void setupUi();
-    void readFile(QTextStream &ts);
+    void readFile(QIODevice *device, qint64 endPos = -1);
     void moveToNextToken();
 
 private:
@@ -83,10 +92,35 @@ private:
     QMenu *runMenu;
     QFrame *runButtonsFrame;
     QAction *restartAction, *stepAction, *runPauseAction, *runToEndAction, *returnToReachedAction;
+    QMenu *runSpeedMenu;
+    QActionGroup *runSpeedActionGroup;
     QStringList allTokens;
     int currentTokenIndex;
     QTimer runStepTimer;
+    // replay speed, in plies per second, 0 => as fast as possible
+    // up to `MaxAnimatedPliesPerSecond` each ply is made (and animated) on its own
+    // above that, plies are made in batches, once per frame, so the board is redrawn once per frame rather than per ply
+    static constexpr int MaxAnimatedPliesPerSecond = 4;
+    static constexpr int FrameInterval = 16;    // (ms)
+    static constexpr int RunTimeSlice = 12;     // (ms) longest spent making plies per frame, leaving time to redraw & handle input
+    int runPliesPerSecond;
+    bool runningBatched;
+    QElapsedTimer runElapsedTimer;
+    int runPliesMade;
+    // "Run to End" resolves the remaining tokens on a worker thread, sharing a `RunToEndJob` with it for progress & cancellation
+    struct RunToEndJob
+    {
+        std::atomic<int> tokensResolved{0};
+        std::atomic<bool> cancelled{false};
+        ZobristKeys::Key startKey = 0;      // position the moves are resolved from, to check the board has not changed meanwhile
+    };
+    std::shared_ptr<RunToEndJob> runToEndJob;
+    QFutureWatcher<GameReplayer::ResolvedMoves> runToEndWatcher;
+    QProgressDialog *runToEndProgressDialog;
+    QTimer runToEndProgressTimer;
     bool doStepOneMove();
+    void startRunning(int pliesPerSecond);
+    void runBatchedPlies(int pliesPerSecond);
 
 public slots:
     void runStepTimerStop();
@@ -99,6 +133,10 @@ private slots:
     void actionRunPause();
     void actionRunToEnd();
     void actionReturnToReached();
+    void actionRunSpeed(QAction *action);
+    void runStepTimerTimeout();
+    void runToEndProgress();
+    void runToEndFinished();
 
 signals:
     void stepOneMove(const QString &token);
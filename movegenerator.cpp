@@ -0,0 +1,306 @@
+#include <QStringList>
+
+#include "movegenerator.h"
+
+GameState::GameState()
+{
+    playerToMove = Piece::White;
+    castlingRights = 0;
+    enpassantSquare = -1;
+}
+
+void GameState::setInitialPosition()
+{
+    // set up the position at the start of a game, as `BoardModel::setupInitialPieces()` does
+    bool ok = setFromFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    Q_ASSERT(ok);
+    Q_UNUSED(ok);
+}
+
+bool GameState::setFromFen(const QString &fen)
+{
+    // set up the position from (the first 4 fields of) a FEN string
+    // e.g. "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", the move counts may be omitted
+    // FEN does not say which side a Rook, Knight or Bishop started on, so that is taken from the column it is on
+    // return false => not valid FEN, the state is then undefined
+    const QStringList fields = fen.split(' ', Qt::SkipEmptyParts);
+    if (fields.count() < 4)
+        return false;
+
+    board.clear();
+    const QStringList rows = fields.at(0).split('/');
+    if (rows.count() != 8)
+        return false;
+    for (int i = 0; i < 8; i++)
+    {
+        // FEN lists the rows from Black's side (row 7) down
+        int row = 7 - i, col = 0;
+        for (QChar ch : rows.at(i))
+        {
+            if (ch >= '1' && ch <= '8')
+            {
+                col += ch.digitValue();
+                continue;
+            }
+            if (col >= 8)
+                return false;
+            Piece::PieceColour colour = ch.isUpper() ? Piece::White : Piece::Black;
+            Piece::PieceName name;
+            switch (ch.toUpper().toLatin1())
+            {
+            case 'B': name = Piece::Bishop; break;
+            case 'K': name = Piece::King; break;
+            case 'N': name = Piece::Knight; break;
+            case 'P': name = Piece::Pawn; break;
+            case 'Q': name = Piece::Queen; break;
+            case 'R': name = Piece::Rook; break;
+            default: return false;
+            }
+            Piece::SideQualifier side = Piece::NoSide;
+            if (name == Piece::Bishop || name == Piece::Knight || name == Piece::Rook)
+                side = (col < 4) ? Piece::QueenSide : Piece::KingSide;
+            board.addPiece(BoardPosition::square(row, col++), Piece(colour, name, side));
+        }
+        if (col != 8)
+            return false;
+    }
+
+    if (fields.at(1) == "w")
+        playerToMove = Piece::White;
+    else if (fields.at(1) == "b")
+        playerToMove = Piece::Black;
+    else
+        return false;
+
+    castlingRights = 0;
+    if (fields.at(2) != "-")
+        for (QChar ch : fields.at(2))
+            switch (ch.toLatin1())
+            {
+            case 'K': castlingRights |= WhiteKingSide; break;
+            case 'Q': castlingRights |= WhiteQueenSide; break;
+            case 'k': castlingRights |= BlackKingSide; break;
+            case 'q': castlingRights |= BlackQueenSide; break;
+            default: return false;
+            }
+
+    enpassantSquare = -1;
+    const QString &enpassant(fields.at(3));
+    if (enpassant != "-")
+    {
+        if (enpassant.length() != 2 || enpassant[0] < 'a' || enpassant[0] > 'h' || enpassant[1] < '1' || enpassant[1] > '8')
+            return false;
+        enpassantSquare = BoardPosition::square(enpassant[1].toLatin1() - '1', enpassant[0].toLatin1() - 'a');
+    }
+    return true;
+}
+
+/*static*/ int GameState::castlingRightsKeptBy(int square)
+{
+    // return the castling rights which survive a move from or to `square`
+    // moving a King or Rook from its starting square, or capturing a Rook on it, loses the corresponding rights
+    switch (square)
+    {
+    case BoardPosition::square(0, 0): return AllCastlingRights & ~WhiteQueenSide;
+    case BoardPosition::square(0, 4): return AllCastlingRights & ~(WhiteKingSide | WhiteQueenSide);
+    case BoardPosition::square(0, 7): return AllCastlingRights & ~WhiteKingSide;
+    case BoardPosition::square(7, 0): return AllCastlingRights & ~BlackQueenSide;
+    case BoardPosition::square(7, 4): return AllCastlingRights & ~(BlackKingSide | BlackQueenSide);
+    case BoardPosition::square(7, 7): return AllCastlingRights & ~BlackKingSide;
+    default: return AllCastlingRights;
+    }
+}
+
+void GameState::makeMove(const PackedMove &move)
+{
+    // make `move`, which must be one of the player to move's, updating the castling rights and enpassant square
+    Q_ASSERT(move.player() == playerToMove);
+    move.make(board);
+    castlingRights &= castlingRightsKeptBy(move.from()) & castlingRightsKeptBy(move.to());
+    if (move.name() == Piece::Pawn && qAbs(move.to() - move.from()) == 16)
+        enpassantSquare = (move.from() + move.to()) / 2;
+    else
+        enpassantSquare = -1;
+    playerToMove = Piece::opposingColour(playerToMove);
+}
+
+
+/*static*/ void MoveGenerator::appendMove(const BoardPosition &board, Piece::PieceColour player, Piece::PieceName name, int squareFrom, int squareTo, MoveList &moves)
+{
+    // append the move of `player`'s piece `name` from `squareFrom` to `squareTo`, a capture if `squareTo` is occupied
+    PackedMove move(player, name, squareFrom, squareTo);
+    if (std::optional<Piece> captured = board.pieceAt(squareTo))
+        move.setCapture(*captured, false);
+    moves.append(move);
+}
+
+/*static*/ void MoveGenerator::appendPawnMoves(const GameState &state, int squareFrom, MoveList &moves)
+{
+    // append the moves of the pawn on `squareFrom`: one or two squares forward, captures, enpassant, and promotion of each
+    const BoardPosition &board(state.board);
+    Piece::PieceColour player = state.playerToMove;
+    bool isWhite = (player == Piece::White);
+    int forward = isWhite ? 8 : -8;
+    int startRow = isWhite ? 1 : 6, lastRow = isWhite ? 7 : 0;
+
+    // a move to the last row is made once for each piece the pawn can be promoted to
+    auto appendPawnMove = [&moves, lastRow](const PackedMove &move)
+    {
+        if (BoardPosition::rowOf(move.to()) != lastRow)
+        {
+            moves.append(move);
+            return;
+        }
+        for (Piece::PieceName promotedTo : { Piece::Queen, Piece::Rook, Piece::Bishop, Piece::Knight })
+        {
+            PackedMove promotion(move);
+            promotion.setPromotion(promotedTo);
+            moves.append(promotion);
+        }
+    };
+
+    int squareTo = squareFrom + forward;
+    if (!board.isOccupied(squareTo))
+    {
+        appendPawnMove(PackedMove(player, Piece::Pawn, squareFrom, squareTo));
+        if (BoardPosition::rowOf(squareFrom) == startRow && !board.isOccupied(squareTo + forward))
+            appendPawnMove(PackedMove(player, Piece::Pawn, squareFrom, squareTo + forward));
+    }
+    BoardPosition::Bitboard captures = attackTables.pawnAttacks[player][squareFrom] & board.occupied(Piece::opposingColour(player));
+    for (; captures; captures &= captures - 1)
+    {
+        squareTo = BoardPosition::lowestSquare(captures);
+        PackedMove move(player, Piece::Pawn, squareFrom, squareTo);
+        move.setCapture(*board.pieceAt(squareTo), false);
+        appendPawnMove(move);
+    }
+    if (state.enpassantSquare >= 0 && (attackTables.pawnAttacks[player][squareFrom] & BoardPosition::squareBit(state.enpassantSquare)))
+    {
+        std::optional<Piece> captured = board.pieceAt(BoardPosition::square(BoardPosition::rowOf(squareFrom), BoardPosition::colOf(state.enpassantSquare)));
+        if (captured && captured->colour != player && captured->name == Piece::Pawn && !board.isOccupied(state.enpassantSquare))
+        {
+            PackedMove move(player, Piece::Pawn, squareFrom, state.enpassantSquare);
+            move.setCapture(*captured, true);
+            moves.append(move);
+        }
+    }
+}
+
+/*static*/ void MoveGenerator::appendCastlingMoves(const GameState &state, MoveList &moves)
+{
+    // append the castling moves the player to move has the right to make now
+    // the King and Rook must be on their squares with nothing between them,
+    // and the King must not be in check nor pass over a square which is attacked
+    // (whether the square it lands on is attacked is left to the legal move test)
+    const BoardPosition &board(state.board);
+    Piece::PieceColour player = state.playerToMove, opponent = Piece::opposingColour(player);
+    bool isWhite = (player == Piece::White);
+    int kingSideRight = isWhite ? GameState::WhiteKingSide : GameState::BlackKingSide;
+    int queenSideRight = isWhite ? GameState::WhiteQueenSide : GameState::BlackQueenSide;
+    if (!(state.castlingRights & (kingSideRight | queenSideRight)))
+        return;
+    int row = isWhite ? 0 : 7;
+    int kingFrom = BoardPosition::square(row, 4);
+    if (!(board.pieces(player, Piece::King) & BoardPosition::squareBit(kingFrom)) || board.attackersTo(kingFrom, opponent))
+        return;
+    BoardPosition::Bitboard rooks = board.pieces(player, Piece::Rook);
+
+    int rookFrom = BoardPosition::square(row, 7);
+    if ((state.castlingRights & kingSideRight) && (rooks & BoardPosition::squareBit(rookFrom))
+            && !board.obstructedMoveFromTo(kingFrom, rookFrom) && !board.attackersTo(kingFrom + 1, opponent))
+    {
+        PackedMove move(player, Piece::King, kingFrom, kingFrom + 2);
+        move.setCastling();
+        moves.append(move);
+    }
+    rookFrom = BoardPosition::square(row, 0);
+    if ((state.castlingRights & queenSideRight) && (rooks & BoardPosition::squareBit(rookFrom))
+            && !board.obstructedMoveFromTo(kingFrom, rookFrom) && !board.attackersTo(kingFrom - 1, opponent))
+    {
+        PackedMove move(player, Piece::King, kingFrom, kingFrom - 2);
+        move.setCastling();
+        moves.append(move);
+    }
+}
+
+/*static*/ void MoveGenerator::generatePseudoLegalMoves(const GameState &state, MoveList &moves)
+{
+    // append all the pseudo-legal moves of the player to move to `moves`
+    // the line pieces use the precomputed `attackTables`, a move along a line being allowed if nothing is between
+    const BoardPosition &board(state.board);
+    Piece::PieceColour player = state.playerToMove;
+    const BoardPosition::Bitboard notOwn = ~board.occupied(player);
+
+    for (BoardPosition::Bitboard pawns = board.pieces(player, Piece::Pawn); pawns; pawns &= pawns - 1)
+        appendPawnMoves(state, BoardPosition::lowestSquare(pawns), moves);
+
+    for (Piece::PieceName name : { Piece::Knight, Piece::Bishop, Piece::Rook, Piece::Queen, Piece::King })
+        for (BoardPosition::Bitboard pieces = board.pieces(player, name); pieces; pieces &= pieces - 1)
+        {
+            int squareFrom = BoardPosition::lowestSquare(pieces);
+            BoardPosition::Bitboard targets;
+            switch (name)
+            {
+            case Piece::Knight: targets = attackTables.knightAttacks[squareFrom]; break;
+            case Piece::King: targets = attackTables.kingAttacks[squareFrom]; break;
+            case Piece::Bishop: targets = attackTables.diagonalLines[squareFrom]; break;
+            case Piece::Rook: targets = attackTables.straightLines[squareFrom]; break;
+            default: targets = attackTables.straightLines[squareFrom] | attackTables.diagonalLines[squareFrom]; break;
+            }
+            bool linePiece = (name != Piece::Knight && name != Piece::King);
+            for (targets &= notOwn; targets; targets &= targets - 1)
+            {
+                int squareTo = BoardPosition::lowestSquare(targets);
+                if (!linePiece || !board.obstructedMoveFromTo(squareFrom, squareTo))
+                    appendMove(board, player, name, squareFrom, squareTo, moves);
+            }
+        }
+
+    appendCastlingMoves(state, moves);
+}
+
+/*static*/ void MoveGenerator::generateLegalMoves(const GameState &state, MoveList &moves)
+{
+    // append all the legal moves of the player to move to `moves`
+    // i.e. the pseudo-legal ones which do not leave the player's King in check (e.g. moving a pinned piece)
+    int first = moves.count();
+    generatePseudoLegalMoves(state, moves);
+    for (int i = moves.count() - 1; i >= first; i--)
+        if (leavesKingInCheck(state.board, moves.at(i)))
+            moves.removeAt(i);
+}
+
+/*static*/ bool MoveGenerator::isInCheck(const BoardPosition &board, Piece::PieceColour player)
+{
+    // return whether `player`'s King is attacked by any opposing piece
+    int kingSquare = board.kingSquare(player);
+    return kingSquare >= 0 && board.attackersTo(kingSquare, Piece::opposingColour(player));
+}
+
+/*static*/ bool MoveGenerator::leavesKingInCheck(const BoardPosition &board, const PackedMove &move)
+{
+    // return whether making `move` on `board` would leave the moving player's King in check
+    BoardPosition after(board);
+    move.make(after);
+    return isInCheck(after, move.player());
+}
+
+/*static*/ quint64 MoveGenerator::perft(const GameState &state, int depth)
+{
+    // return the number of leaf nodes of the legal move tree to `depth` plies from `state`
+    // these counts are known for standard positions, so they verify the generator (and `PackedMove::make()`)
+    if (depth <= 0)
+        return 1;
+    MoveList moves;
+    generateLegalMoves(state, moves);
+    if (depth == 1)
+        return moves.count();
+    quint64 nodes = 0;
+    for (const PackedMove &move : moves)
+    {
+        GameState next(state);
+        next.makeMove(move);
+        nodes += perft(next, depth - 1);
+    }
+    return nodes;
+}
@@ -0,0 +1,72 @@
+#ifndef MOVEGENERATOR_H
+#define MOVEGENERATOR_H
+
+#include <QString>
+
+#include "boardposition.h"
+#include "packedmove.h"
+#include "piece.h"
+
+// a position as the move generator needs it:
+// the pieces, plus what they alone do not tell, the player to move, the castling rights and the enpassant square
+class GameState
+{
+public:
+    GameState();
+
+    enum CastlingRight { WhiteKingSide = 1, WhiteQueenSide = 2, BlackKingSide = 4, BlackQueenSide = 8, AllCastlingRights = 15 };
+
+    BoardPosition board;
+    Piece::PieceColour playerToMove;
+    int castlingRights;         // `CastlingRight` flags
+    int enpassantSquare;        // square a pawn which has just moved two squares passed over, -1 => none
+
+    void setInitialPosition();
+    bool setFromFen(const QString &fen);
+    void makeMove(const PackedMove &move);
+    inline ZobristKeys::Key key() const { return board.key(playerToMove); }
+
+private:
+    static int castlingRightsKeptBy(int square);
+};
+
+// a fixed-capacity list of moves, held inline so that generating moves does not allocate
+class MoveList
+{
+public:
+    // no legal chess position has more than 218 moves
+    enum { MaxMoves = 256 };
+
+    inline int count() const { return _count; }
+    inline bool isEmpty() const { return _count == 0; }
+    inline const PackedMove &at(int i) const { Q_ASSERT(i >= 0 && i < _count); return moves[i]; }
+    inline const PackedMove *begin() const { return moves; }
+    inline const PackedMove *end() const { return moves + _count; }
+    inline void append(const PackedMove &move) { Q_ASSERT(_count < MaxMoves); moves[_count++] = move; }
+    inline void removeAt(int i) { Q_ASSERT(i >= 0 && i < _count); moves[i] = moves[--_count]; }
+    inline void clear() { _count = 0; }
+
+private:
+    PackedMove moves[MaxMoves];
+    int _count = 0;
+};
+
+// generates the moves of the player to move in a `GameState`
+// pseudo-legal moves obey how the pieces move, castling rights and enpassant, but may leave the player's own King in check
+// legal moves are those pseudo-legal moves which do not
+class MoveGenerator
+{
+public:
+    static void generatePseudoLegalMoves(const GameState &state, MoveList &moves);
+    static void generateLegalMoves(const GameState &state, MoveList &moves);
+    static bool isInCheck(const BoardPosition &board, Piece::PieceColour player);
+    static bool leavesKingInCheck(const BoardPosition &board, const PackedMove &move);
+    static quint64 perft(const GameState &state, int depth);
+
+private:
+    static void appendMove(const BoardPosition &board, Piece::PieceColour player, Piece::PieceName name, int squareFrom, int squareTo, MoveList &moves);
+    static void appendPawnMoves(const GameState &state, int squareFrom, MoveList &moves);
+    static void appendCastlingMoves(const GameState &state, MoveList &moves);
+};
+
+#endif // MOVEGENERATOR_H
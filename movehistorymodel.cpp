@@ -1,5 +1,6 @@
 #include <QDebug>
 
+#include "boardmodel.h"
 #include "movehistorymodel.h"
 
 MoveHistoryModel::MoveHistoryModel(QObject *parent)
@@ -7,12 +8,15 @@ MoveHistoryModel::MoveHistoryModel(QObject *parent)
 {
     _moves.clear();
     _playerToMove = Piece::White;
+    textPly = 0;
+    textCache.setMaxCost(TextCacheSize);
 }
 
 /*virtual*/ int MoveHistoryModel::rowCount(const QModelIndex &parent) const /*override*/
 {
     Q_ASSERT(!parent.isValid());
-    return _moves.count();
+    // a row per turn, and we always show new (blank) row for white's next move
+    return _moves.count() / 2 + 1;
 }
 
 /*virtual*/ int MoveHistoryModel::columnCount(const QModelIndex &parent) const /*override*/
@@ -26,107 +30,73 @@ MoveHistoryModel::MoveHistoryModel(QObject *parent)
     if (!index.isValid())
         return QVariant();
     Q_ASSERT(index.column() < 2);
-    Q_ASSERT(index.row() < _moves.count());
+    Q_ASSERT(index.row() < rowCount());
 
     if (role == Qt::DisplayRole || role == Qt::EditRole)
     {
-        return _moves.at(index.row()).at(index.column()).move;
+        return textOfMove(index.row(), static_cast<Piece::PieceColour>(index.column()));
     }
     return QVariant();
 }
 
-/*virtual*/ bool MoveHistoryModel::setData(const QModelIndex &index, const QVariant &value, int role) /*override*/
-{
-    if (!index.isValid())
-        return false;
-    Q_ASSERT(index.column() < 2);
-    Q_ASSERT(index.row() < _moves.count());
-
-    if (role == Qt::EditRole)
-    {
-        _moves[index.row()][index.column()].move = value.toString();
-        emit dataChanged(index, index, { role });
-        return true;
-    }
-    return false;
-}
-
-/*virtual*/ bool MoveHistoryModel::insertRows(int row, int count, const QModelIndex &parent) /*override*/
-{
-    Q_ASSERT(!parent.isValid());
-    if (count < 1)
-        return false;
-    // can only append new rows at the end (not in the middle)
-    if (row != _moves.count())
-        return false;
-
-    // resize `_moves` to have `count` new rows at the end
-    beginInsertRows(parent, row, row + count - 1);
-    _moves.resize(_moves.count() + count);
-    endInsertRows();
-    return true;
-}
-
-/*virtual*/ bool MoveHistoryModel::removeRows(int row, int count, const QModelIndex &parent) /*override*/
-{
-    Q_ASSERT(!parent.isValid());
-    if (count < 1)
-        return false;
-    // can only remove rows at the end (not in the middle)
-    if (row != _moves.count() - 1)
-        return false;
-
-    // resize `_moves` to have `count` fewer rows at the end
-    beginRemoveRows(parent, row, row + count - 1);
-    _moves.resize(_moves.count() - count);
-    endRemoveRows();
-    return true;
-}
-
 /*virtual*/ void MoveHistoryModel::clear()
 {
     beginResetModel();
     _moves.clear();
     _playerToMove = Piece::White;
+    textPosition = startPosition;
+    textPly = 0;
+    textCache.clear();
     endResetModel();
-    // always show new (blank) row for white's next move
-    insertRow(0);
 }
 
-const QString &MoveHistoryModel::textOfMove(int turn, Piece::PieceColour player) const
+void MoveHistoryModel::setStartPosition(const BoardPosition &position)
+{
+    // set the position before the first move, which regenerating the text of moves starts from
+    Q_ASSERT(_moves.isEmpty());
+    startPosition = textPosition = position;
+    textPly = 0;
+    textCache.clear();
+}
+
+QString MoveHistoryModel::textOfMove(int turn, Piece::PieceColour player) const
 {
     // return the text of the move for turn and player
-    Q_ASSERT(turn >= 0 && turn < _moves.count());
-    return _moves.at(turn).at(player).move;
+    // (empty for the move not yet made in the last row)
+    Q_ASSERT(turn >= 0 && turn < rowCount());
+    int ply = turn * 2 + player;
+    if (ply >= _moves.count())
+        return QString();
+    return textOfPly(ply);
 }
 
 const QString MoveHistoryModel::textOfLastMoveMade() const
 {
     // return the text of the last move made
-    int turn = rowCount() - 1;
-    Piece::PieceColour player = Piece::opposingColour(_playerToMove);
-    if (player == Piece::Black)
-        if (--turn < 0)
-            return QString();
-    return textOfMove(turn, player);
+    if (_moves.isEmpty())
+        return QString();
+    return textOfPly(_moves.count() - 1);
 }
 
-void MoveHistoryModel::appendMove(Piece::PieceColour player, const QString &text)
+void MoveHistoryModel::appendMove(const PackedMove &move)
 {
     // append the latest move by player to the move history
     // note that we only allow appending of latest move, no kind of inserting/replacing
-    Q_ASSERT(player == _playerToMove);
-    // we always show new (blank) row for white's next move
-    Q_ASSERT(rowCount() > 0);
-
-    // set the text of the move in the (last row of) the model
-    QModelIndex index(createIndex(rowCount() - 1, _playerToMove));
-    setData(index, text);
+    Q_ASSERT(move.player() == _playerToMove);
+
+    int ply = _moves.count();
+    // if it's a move by black append a new (blank) row for white's next move
+    bool appendRow = (_playerToMove == Piece::Black);
+    if (appendRow)
+        beginInsertRows(QModelIndex(), ply / 2 + 1, ply / 2 + 1);
+    _moves.append(move);
+    if (appendRow)
+        endInsertRows();
     // switch which player is to move next
     _playerToMove = Piece::opposingColour(_playerToMove);
-    // if it's a move by white append a new (blank) row
-    if (_playerToMove == Piece::White)
-        insertRow(_moves.count());
+    // the text of the move in the (last row of) the model has changed
+    QModelIndex index(createIndex(ply / 2, ply % 2));
+    emit dataChanged(index, index, { Qt::DisplayRole, Qt::EditRole });
 
     // let outside world a move has been appended
     emit moveAppended();
@@ -137,30 +107,54 @@ void MoveHistoryModel::removeLastMove()
     // remove the latest move by player from the move history
     // (used when undoing moves)
     // note that we only allow removing of latest move, no kind of removing/replacing previous moves
-    Q_ASSERT(rowCount() > 0);
+    Q_ASSERT(!_moves.isEmpty());
 
+    int ply = _moves.count() - 1;
+    // the position for regenerating text must not be beyond the move being removed, and its text is no longer valid
+    if (textPly > ply)
+        stepTextPositionTo(ply);
+    textCache.remove(ply);
     // if awaiting a move by white remove the last row (which contains the next white move)
-    if (_playerToMove == Piece::White)
-        removeRow(rowCount() - 1);
+    bool removeRow = (_playerToMove == Piece::White);
+    if (removeRow)
+        beginRemoveRows(QModelIndex(), ply / 2 + 1, ply / 2 + 1);
+    _moves.removeLast();
+    if (removeRow)
+        endRemoveRows();
     // switch which player is to move next
     _playerToMove = Piece::opposingColour(_playerToMove);
     // clear the text of the move in the (last row of) the model
-    Q_ASSERT(rowCount() > 0);
-    QModelIndex index(createIndex(rowCount() - 1, _playerToMove));
-    setData(index, QVariant());
+    QModelIndex index(createIndex(ply / 2, ply % 2));
+    emit dataChanged(index, index, { Qt::DisplayRole, Qt::EditRole });
 
     // let outside world a move has been appended
     emit lastMoveRemoved();
 }
 
+void MoveHistoryModel::resetMoves(const QVector<PackedMove> &moves, int count)
+{
+    // reset the move history to the first `count` of `moves` in one go
+    // (used when jumping many moves forward/back, rather than appending/removing them one at a time)
+    // the moves up to whichever is the shorter of the old and new histories are the same, so their texts remain valid
+    Q_ASSERT(count >= 0 && count <= moves.count());
+
+    beginResetModel();
+    int oldCount = _moves.count();
+    if (textPly > count)
+        stepTextPositionTo(count);
+    for (int ply = count; ply < oldCount; ply++)
+        textCache.remove(ply);
+    _moves = moves.mid(0, count);
+    _playerToMove = (count % 2 == 0) ? Piece::White : Piece::Black;
+    endResetModel();
+}
+
 void MoveHistoryModel::saveMoveHistory(QTextStream &ts, bool insertTurnNumber /*= true*/) const
 {
     // save the text of moves from model to file
-    int lastMove = rowCount() - 1;
     // don't output the last, blank row
-    if (lastMove >= 0 && textOfMove(lastMove, Piece::White).isEmpty())
-        lastMove--;
-    for (int i = 0; i <= lastMove; i++)
+    int turns = (_moves.count() + 1) / 2;
+    for (int i = 0; i < turns; i++)
     {
         if (insertTurnNumber)
             ts << i + 1 << ". ";
@@ -168,3 +162,28 @@ void MoveHistoryModel::saveMoveHistory(QTextStream &ts, bool insertTurnNumber /*
     }
 }
 
+QString MoveHistoryModel::textOfPly(int ply) const
+{
+    // return the text of the move at `ply`, regenerating it if it is not in the cache
+    Q_ASSERT(ply >= 0 && ply < _moves.count());
+    if (const QString *text = textCache.object(ply))
+        return *text;
+
+    const PackedMove &move(_moves.at(ply));
+    stepTextPositionTo(ply);
+    MoveParser mp(&textPosition, move.player());
+    QString text(mp.moveText(move));
+    textCache.insert(ply, new QString(text));
+    return text;
+}
+
+void MoveHistoryModel::stepTextPositionTo(int ply) const
+{
+    // make/unmake moves on `textPosition` till it is the position before `ply`
+    // the view asks for consecutive moves, so this is usually just a step or two
+    Q_ASSERT(ply >= 0 && ply <= _moves.count());
+    while (textPly < ply)
+        _moves.at(textPly++).make(textPosition);
+    while (textPly > ply)
+        _moves.at(--textPly).unmake(textPosition);
+}
@@ -2,9 +2,12 @@
 #define MOVEHISTORYMODEL_H
 
 #include <QAbstractTableModel>
+#include <QCache>
 #include <QTextStream>
 #include <QVector>
 
+#include "boardposition.h"
+#include "packedmove.h"
 #include "piece.h"
 
 class MoveHistoryModel : public QAbstractTableModel
@@ -19,35 +22,36 @@ public:
     virtual int columnCount(const QModelIndex &parent = QModelIndex()) const override;
 
     virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
-    virtual bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
 
     // Add/remove data:
-    virtual bool insertRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
-    virtual bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
     virtual void clear();
 
     inline Piece::PieceColour playerToMove() const { return _playerToMove; }
-    const QString &textOfMove(int turn, Piece::PieceColour player) const;
+    inline int moveCount() const { return _moves.count(); }
+    inline const PackedMove &moveAt(int ply) const { return _moves.at(ply); }
+    void setStartPosition(const BoardPosition &position);
+    QString textOfMove(int turn, Piece::PieceColour player) const;
     const QString textOfLastMoveMade() const;
-    void appendMove(Piece::PieceColour player, const QString &text);
+    void appendMove(const PackedMove &move);
     void removeLastMove();
+    void resetMoves(const QVector<PackedMove> &moves, int count);
     void saveMoveHistory(QTextStream &ts, bool insertTurnNumber = true) const;
 
 private:
-    struct Move
-    {
-        QString move;
-    };
-    struct MovePair
-    {
-        Move whiteMove, blackMove;
-
-        const Move &at(int i) const { if (i == 0) return whiteMove; else if (i == 1) return blackMove; else throw std::out_of_range("at(): index out of range"); }
-        Move &operator[](int i) { if (i == 0) return whiteMove; else if (i == 1) return blackMove; else throw std::out_of_range("[]: index out of range"); }
-        const Move &operator[](int i) const { if (i == 0) return whiteMove; else if (i == 1) return blackMove; else throw std::out_of_range("[]: index out of range"); }
-    };
-    QVector<MovePair> _moves;
+    // the moves are held packed, one per ply (White's first move is ply 0), as the canonical history
+    // their text is only regenerated when wanted, which needs the position before the move:
+    // `textPosition` is kept as the position before ply `textPly`, and is stepped forward/back to the ply wanted
+    // the texts most recently regenerated are cached, so that redisplaying the view does not regenerate them
+    enum { TextCacheSize = 256 };
+    QVector<PackedMove> _moves;
     Piece::PieceColour _playerToMove;
+    BoardPosition startPosition;
+    mutable BoardPosition textPosition;
+    mutable int textPly;
+    mutable QCache<int, QString> textCache;
+
+    QString textOfPly(int ply) const;
+    void stepTextPositionTo(int ply) const;
 
 signals:
     void moveAppended();
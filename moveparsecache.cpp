@@ -0,0 +1,51 @@
+#include <QHash>
+
+#include "moveparsecache.h"
+
+MoveParseCache::MoveParseCache(int maxEntries /*= DefaultMaxEntries*/)
+{
+    cache.setMaxCost(maxEntries);
+}
+
+void MoveParseCache::clear()
+{
+    // discard all the entries, the stats are kept
+    cache.clear();
+}
+
+MoveParseCache::Key::Key(const BoardPosition &position, Piece::PieceColour player, const QString &text)
+{
+    // combine everything an entry is keyed on into the 64-bit key the entry is held under
+    // `text` must already be normalized by `MoveParser::cacheKeyText()`
+    positionKey = position.key(player);
+    kingSide = position.sideQualified(Piece::KingSide);
+    queenSide = position.sideQualified(Piece::QueenSide);
+    this->text = text;
+    hash = positionKey ^ (kingSide * 0x9E3779B97F4A7C15) ^ (queenSide * 0xC2B2AE3D27D4EB4F) ^ (quint64(qHash(text)) * 0x165667B19E3779F9);
+}
+
+const QList<MoveParser::ParsedMove> *MoveParseCache::find(const Key &key, bool check)
+{
+    // return the moves the text of `key` resolved to, nullptr => not in the cache
+    // `check` tells whether the text being parsed had a check qualifier
+    // an entry resolved with one is only valid for text with one, while one resolved without is valid for text with one if its move gives check
+    // (the check qualifier only ever narrows the moves which could be meant, so if the move without it gives check it is still the one meant)
+    const Entry *entry = cache.object(key.hash);
+    if (!entry || entry->positionKey != key.positionKey || entry->kingSide != key.kingSide || entry->queenSide != key.queenSide || entry->text != key.text
+            || (check ? !(entry->resolvedWithCheck || entry->givesCheck) : entry->resolvedWithCheck))
+    {
+        _stats.misses++;
+        return nullptr;
+    }
+    _stats.hits++;
+    return &entry->moves;
+}
+
+void MoveParseCache::insert(const Key &key, bool check, bool givesCheck, const QList<MoveParser::ParsedMove> &moves)
+{
+    // cache the moves the text of `key` successfully resolved to, `check` telling whether the text had a check qualifier
+    // this replaces any entry which happened to have the same hash
+    Q_ASSERT(!moves.isEmpty());
+    Entry *entry = new Entry{ key.positionKey, key.kingSide, key.queenSide, key.text, check, givesCheck, moves };
+    cache.insert(key.hash, entry);
+}
@@ -0,0 +1,68 @@
+#ifndef MOVEPARSECACHE_H
+#define MOVEPARSECACHE_H
+
+#include <QCache>
+#include <QList>
+#include <QString>
+
+#include "boardmodel.h"
+#include "boardposition.h"
+#include "piece.h"
+
+// a bounded cache of moves already resolved by `MoveParser::parse()`, keyed by the position, player and normalized move text
+// the text is normalized by `MoveParser::cacheKeyText()`: upper-cased, with the spelling of "e.p." and any check ("ch"/"+") dropped
+// a check qualifier can narrow which move is meant, so an entry records whether it was resolved with one and whether its move gives check,
+// then e.g. "P-K4ch" finds "P-K4"'s entry if that move gives check, but "P-K4" does not find an entry resolved only thanks to "ch"
+// most games share their opening moves, so replaying many games, or the same game again, resolves the same moves repeatedly
+// the least recently used entries are discarded once `maxEntries()` is reached
+// only successful parses are cached, a failed parse is always re-parsed so that its message is reported
+// a cache is not thread-safe, each thread (e.g. each `BatchReplayer` worker) has its own
+class MoveParseCache
+{
+public:
+    MoveParseCache(int maxEntries = DefaultMaxEntries);
+
+    struct Stats
+    {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        Stats &operator+=(const Stats &other) { hits += other.hits; misses += other.misses; return *this; }
+    };
+
+    inline int maxEntries() const { return cache.maxCost(); }
+    inline int count() const { return cache.count(); }
+    inline const Stats &stats() const { return _stats; }
+    inline void resetStats() { _stats = Stats(); }
+    void clear();
+
+    // what an entry is keyed on, worked out once per parse and passed to both `find()` and `insert()`
+    // the Zobrist key does not include the pieces' sides, which "KR"/"QN" etc. refer to, so those are part of the key too
+    // entries are hashed on all of these, and compared in full on lookup so a hash collision is just a miss
+    struct Key
+    {
+        ZobristKeys::Key positionKey;
+        BoardPosition::Bitboard kingSide, queenSide;
+        QString text;       // normalized
+        quint64 hash;
+        Key(const BoardPosition &position, Piece::PieceColour player, const QString &text);
+    };
+
+    const QList<MoveParser::ParsedMove> *find(const Key &key, bool check);
+    void insert(const Key &key, bool check, bool givesCheck, const QList<MoveParser::ParsedMove> &moves);
+
+private:
+    enum { DefaultMaxEntries = 4096 };
+    struct Entry
+    {
+        ZobristKeys::Key positionKey;
+        BoardPosition::Bitboard kingSide, queenSide;
+        QString text;
+        bool resolvedWithCheck;     // the text had a check qualifier
+        bool givesCheck;            // the move passes the parser's check test
+        QList<MoveParser::ParsedMove> moves;
+    };
+    QCache<quint64, Entry> cache;
+    Stats _stats;
+};
+
+#endif // MOVEPARSECACHE_H
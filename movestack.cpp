@@ -0,0 +1,60 @@
+#include "movestack.h"
+
+MoveStack::MoveStack()
+{
+    _index = 0;
+    _cleanIndex = 0;
+    snapshots.append(BoardPosition());
+    keys.append(snapshots.first().key(Piece::White));
+}
+
+void MoveStack::clear(const BoardPosition &startPosition)
+{
+    // clear all moves, starting again from `startPosition`
+    moves.clear();
+    snapshots.clear();
+    snapshots.append(startPosition);
+    keys.clear();
+    keys.append(startPosition.key(Piece::White));
+    _index = 0;
+    _cleanIndex = 0;
+}
+
+void MoveStack::push(const PackedMove &move, const BoardPosition &positionAfter)
+{
+    // push a move just made, `positionAfter` being the position after it
+    // like `QUndoStack::push()` this discards any moves which had been undone,
+    // and if that discards the clean index there is then no longer one
+    if (_index < moves.count())
+    {
+        moves.resize(_index);
+        snapshots.resize(_index / SnapshotInterval + 1);
+        keys.resize(_index + 1);
+        if (_cleanIndex > _index)
+            _cleanIndex = -1;
+    }
+    moves.append(move);
+    keys.append(positionAfter.key(Piece::opposingColour(move.player())));
+    _index++;
+    if (_index % SnapshotInterval == 0)
+        snapshots.append(positionAfter);
+}
+
+void MoveStack::setIndex(int index)
+{
+    // set the number of moves currently made
+    // the caller is responsible for making/unmaking the moves on the board
+    Q_ASSERT(index >= 0 && index <= moves.count());
+    _index = index;
+}
+
+BoardPosition MoveStack::positionAt(int ply) const
+{
+    // return the position after `ply` moves
+    Q_ASSERT(ply >= 0 && ply <= moves.count());
+    int snapshotPly = (ply / SnapshotInterval) * SnapshotInterval;
+    BoardPosition position(snapshots.at(ply / SnapshotInterval));
+    for (int i = snapshotPly; i < ply; i++)
+        moves.at(i).make(position);
+    return position;
+}
@@ -0,0 +1,47 @@
+#ifndef MOVESTACK_H
+#define MOVESTACK_H
+
+#include <QVector>
+
+#include "boardposition.h"
+#include "packedmove.h"
+
+// the moves made in a game, held contiguously, along which moves can be undone and redone
+// `index()` is the number of moves currently made, those beyond it have been undone and can be redone (till a new move is pushed)
+// a snapshot of the position is kept every `SnapshotInterval` moves,
+// so that the position at any ply can be had by making at most `SnapshotInterval - 1` moves on the nearest snapshot
+// the Zobrist key of the position at every ply is kept too, e.g. for detecting repetition
+class MoveStack
+{
+public:
+    MoveStack();
+
+    inline int count() const { return moves.count(); }
+    inline int index() const { return _index; }
+    inline const PackedMove &at(int ply) const { return moves.at(ply); }
+    inline const QVector<PackedMove> &allMoves() const { return moves; }
+    inline ZobristKeys::Key keyAt(int ply) const { return keys.at(ply); }
+    inline bool canUndo() const { return _index > 0; }
+    inline bool canRedo() const { return _index < moves.count(); }
+
+    void clear(const BoardPosition &startPosition);
+    void push(const PackedMove &move, const BoardPosition &positionAfter);
+    void setIndex(int index);
+    BoardPosition positionAt(int ply) const;
+
+    inline void setClean() { _cleanIndex = _index; }
+    inline bool isClean() const { return _cleanIndex == _index; }
+    inline int cleanIndex() const { return _cleanIndex; }
+
+private:
+    enum { SnapshotInterval = 16 };
+    QVector<PackedMove> moves;
+    // `snapshots[i]` is the position after `i * SnapshotInterval` moves, there is always one for every such ply up to `count()`
+    QVector<BoardPosition> snapshots;
+    // `keys[i]` is the Zobrist key, including the side to move, of the position after `i` moves
+    QVector<ZobristKeys::Key> keys;
+    int _index;
+    int _cleanIndex;     // -1 => no clean index
+};
+
+#endif // MOVESTACK_H
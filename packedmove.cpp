@@ -0,0 +1,79 @@
+#include "packedmove.h"
+
+PackedMove::PackedMove(Piece::PieceColour player, Piece::PieceName name, int squareFrom, int squareTo)
+{
+    // a simple move of `player`'s piece `name` from `squareFrom` to `squareTo`
+    // capture, castling and promotion are added by `setCapture()`, `setCastling()` and `setPromotion()`
+    Q_ASSERT(squareFrom >= 0 && squareFrom < 64 && squareTo >= 0 && squareTo < 64 && squareFrom != squareTo);
+    bits = quint32(squareFrom) | (quint32(squareTo) << ToShift) | (quint32(name) << NameShift) | (quint32(player) << PlayerShift);
+}
+
+Piece PackedMove::capturedPiece() const
+{
+    // return the piece captured, including the side it started on (so that undoing the capture restores it exactly)
+    Q_ASSERT(isCapture());
+    return Piece(Piece::opposingColour(player()),
+                 static_cast<Piece::PieceName>((bits >> CapturedNameShift) & NameMask),
+                 static_cast<Piece::SideQualifier>((bits >> CapturedSideShift) & SideMask));
+}
+
+int PackedMove::capturedSquare() const
+{
+    // return the square of the piece captured
+    // this is the square moved to, except for enpassant where it is the square alongside the square moved from
+    Q_ASSERT(isCapture());
+    if (isEnpassant())
+        return BoardPosition::square(BoardPosition::rowOf(from()), BoardPosition::colOf(to()));
+    return to();
+}
+
+void PackedMove::setCapture(const Piece &captured, bool enpassant)
+{
+    Q_ASSERT(captured.colour != player());
+    bits |= CaptureFlag | (quint32(captured.name) << CapturedNameShift) | (quint32(captured.side) << CapturedSideShift);
+    if (enpassant)
+        bits |= EnpassantFlag;
+}
+
+void PackedMove::setCastling()
+{
+    Q_ASSERT(name() == Piece::King);
+    bits |= CastlingFlag;
+}
+
+void PackedMove::setPromotion(Piece::PieceName promotedTo)
+{
+    Q_ASSERT(name() == Piece::Pawn);
+    bits |= PromotionFlag | (quint32(promotedTo) << PromotedToShift);
+}
+
+void PackedMove::make(BoardPosition &position) const
+{
+    // make the move on `position`
+    if (isCapture())
+        position.removePiece(capturedSquare());
+    position.movePiece(from(), to());
+    if (isCastling())
+        position.movePiece(castlingRookFrom(), castlingRookTo());
+    if (isPromotion())
+    {
+        position.removePiece(to());
+        position.addPiece(to(), Piece(player(), promotedTo()));
+    }
+}
+
+void PackedMove::unmake(BoardPosition &position) const
+{
+    // unmake the move on `position`, which must be the position `make()` left
+    // this is `make()` in reverse
+    if (isPromotion())
+    {
+        position.removePiece(to());
+        position.addPiece(to(), Piece(player(), Piece::Pawn));
+    }
+    if (isCastling())
+        position.movePiece(castlingRookTo(), castlingRookFrom());
+    position.movePiece(to(), from());
+    if (isCapture())
+        position.addPiece(capturedSquare(), capturedPiece());
+}
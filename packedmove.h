@@ -0,0 +1,57 @@
+#ifndef PACKEDMOVE_H
+#define PACKEDMOVE_H
+
+#include <QtGlobal>
+
+#include "boardposition.h"
+#include "piece.h"
+
+// a move packed into 32 bits, the canonical form in which moves are kept in the undo stack and the move history
+// it holds everything needed to make and to exactly unmake the move on a `BoardPosition`,
+// the descriptive text of the move is regenerated from it (and the position before it) only when wanted
+class PackedMove
+{
+public:
+    PackedMove() { bits = 0; }
+    PackedMove(Piece::PieceColour player, Piece::PieceName name, int squareFrom, int squareTo);
+
+    inline bool isNull() const { return bits == 0; }
+    inline quint32 toUInt() const { return bits; }
+    inline bool operator==(const PackedMove &other) const { return bits == other.bits; }
+    inline bool operator!=(const PackedMove &other) const { return bits != other.bits; }
+
+    inline int from() const { return bits & SquareMask; }
+    inline int to() const { return (bits >> ToShift) & SquareMask; }
+    inline Piece::PieceName name() const { return static_cast<Piece::PieceName>((bits >> NameShift) & NameMask); }
+    inline Piece::PieceColour player() const { return static_cast<Piece::PieceColour>((bits >> PlayerShift) & 1); }
+
+    inline bool isCapture() const { return bits & CaptureFlag; }
+    inline bool isEnpassant() const { return bits & EnpassantFlag; }
+    inline bool isCastling() const { return bits & CastlingFlag; }
+    inline bool isPromotion() const { return bits & PromotionFlag; }
+    Piece capturedPiece() const;
+    int capturedSquare() const;
+    inline Piece::PieceName promotedTo() const { return static_cast<Piece::PieceName>((bits >> PromotedToShift) & NameMask); }
+    inline bool isKingSideCastling() const { return BoardPosition::colOf(to()) == 6; }
+    inline int castlingRookFrom() const { return BoardPosition::square(BoardPosition::rowOf(from()), isKingSideCastling() ? 7 : 0); }
+    inline int castlingRookTo() const { return BoardPosition::square(BoardPosition::rowOf(from()), isKingSideCastling() ? 5 : 3); }
+
+    void setCapture(const Piece &captured, bool enpassant);
+    void setCastling();
+    void setPromotion(Piece::PieceName promotedTo);
+
+    void make(BoardPosition &position) const;
+    void unmake(BoardPosition &position) const;
+
+private:
+    // bits 0-5 from, 6-11 to, 12-14 piece name, 15 player, 16-18 promoted to, 19-21 captured name, 22-23 captured side, 24-27 flags
+    enum
+    {
+        SquareMask = 0x3F, NameMask = 0x7, SideMask = 0x3,
+        ToShift = 6, NameShift = 12, PlayerShift = 15, PromotedToShift = 16, CapturedNameShift = 19, CapturedSideShift = 22,
+        CaptureFlag = 1 << 24, EnpassantFlag = 1 << 25, CastlingFlag = 1 << 26, PromotionFlag = 1 << 27
+    };
+    quint32 bits;
+};
+
+#endif // PACKEDMOVE_H
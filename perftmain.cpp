@@ -0,0 +1,99 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include "boardmodel.h"
+#include "movegenerator.h"
+
+// positions with known perft node counts, which between them exercise castling, enpassant, promotion, pins and checks
+// `nodes[d]` is the count to depth `d + 1`
+struct PerftPosition
+{
+    const char *name;
+    const char *fen;
+    quint64 nodes[6];
+};
+
+static const PerftPosition perftPositions[] =
+{
+    { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", { 48, 2039, 97862, 4085603, 193690690, 0 } },
+    { "endgame", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", { 14, 191, 2812, 43238, 674624, 11030083 } },
+    { "promotions", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", { 6, 264, 9467, 422333, 15833292, 0 } },
+    { "discovered checks", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", { 44, 1486, 62379, 2103487, 89941194, 0 } },
+    { "symmetrical", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", { 46, 2079, 89890, 3894594, 164075551, 0 } },
+};
+
+// node counts from the start of a game
+static const quint64 initialNodes[] = { 20, 400, 8902, 197281, 4865609, 119060324 };
+
+int main(int argc, char *argv[])
+{
+    // console program to verify and time the move generator by perft
+    // usage: chessperft [-d depth]
+    // counts the nodes of the legal move tree to `depth` plies (default 4, at most 6) from the start of a game,
+    // as set up by `BoardModel::newGame()`, and from a set of FEN positions, and checks them against the known counts
+    // prints the nodes and nodes/second for each, exit status is the number of positions whose count is wrong (capped at 125), or 255 for a usage error
+    QCoreApplication a(argc, argv);
+    QTextStream out(stdout), err(stderr);
+
+    QStringList args = QCoreApplication::arguments().mid(1);
+    int depth = 4;
+    int depthIndex = args.indexOf("-d");
+    if (depthIndex >= 0 && depthIndex + 1 < args.count())
+    {
+        depth = qBound(1, args.at(depthIndex + 1).toInt(), 6);
+        args.removeAt(depthIndex + 1);
+        args.removeAt(depthIndex);
+    }
+    if (!args.isEmpty())
+    {
+        err << "Usage: chessperft [-d depth]" << Qt::endl;
+        return 255;
+    }
+
+    int failed = 0;
+    quint64 totalNodes = 0;
+    QElapsedTimer totalTimer;
+    totalTimer.start();
+    auto runPerft = [&](const QString &name, const GameState &state, quint64 expectedNodes)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        quint64 nodes = MoveGenerator::perft(state, depth);
+        double seconds = qMax(timer.nsecsElapsed(), qint64(1)) / 1e9;
+        totalNodes += nodes;
+        // a count of 0 is one not known (too big to be worth listing)
+        bool ok = (expectedNodes == 0 || nodes == expectedNodes);
+        if (!ok)
+            failed++;
+        out << QString("%1 depth %2: %3 nodes in %4 s: %5 nodes/s %6")
+               .arg(name, -20).arg(depth).arg(nodes, 12).arg(seconds, 0, 'f', 3).arg(nodes / seconds, 12, 'f', 0)
+               .arg(ok ? "OK" : QString("FAILED, expected %1").arg(expectedNodes)) << Qt::endl;
+    };
+
+    // the start of a game, exactly as the board model sets it up
+    BoardModel boardModel;
+    boardModel.newGame();
+    GameState initial;
+    initial.board = boardModel.position();
+    initial.playerToMove = Piece::White;
+    initial.castlingRights = GameState::AllCastlingRights;
+    runPerft("initial", initial, initialNodes[depth - 1]);
+
+    for (const PerftPosition &position : perftPositions)
+    {
+        GameState state;
+        if (!state.setFromFen(position.fen))
+        {
+            err << position.name << ": invalid FEN: " << position.fen << Qt::endl;
+            failed++;
+            continue;
+        }
+        runPerft(position.name, state, position.nodes[depth - 1]);
+    }
+
+    double seconds = qMax(totalTimer.nsecsElapsed(), qint64(1)) / 1e9;
+    err << QString("%1 nodes in %2 s: %3 nodes/s").arg(totalNodes).arg(seconds, 0, 'f', 3).arg(totalNodes / seconds, 0, 'f', 0) << Qt::endl;
+
+    return qMin(failed, 125);
+}
@@ -1,12 +1,19 @@
 #include <QColor>
 #include <QDebug>
 #include <QDir>
+#include <QPixmapCache>
+#include <QtConcurrent>
 
 #include "pieceimages.h"
+#include "pixelkernels.h"
+
+QMutex PieceImages::decodedPieceSetsMutex;
+QHash<QString, PieceImages::DecodedPieceSet> PieceImages::decodedPieceSets;
 
 PieceImages::PieceImages(const QString &dirPath)
 {
     // the piece set name is the directory name
+    _dirPath = dirPath;
     _pieceSetName = QDir(dirPath).dirName();
 
     images[0].clear();
@@ -15,18 +22,13 @@ PieceImages::PieceImages(const QString &dirPath)
 //    //TEMPORARY
 //    produceFilesFromCombinedFile(dirPath);
 
+    // the `QImage`s in `images[][].image`, allowing for potential future colour change, are (shared with) the decoded piece set
+    const DecodedPieceSet pieceSet(decodedPieceSet(dirPath));
     for (int i = 0; i <= 1; i++)
     {
-        // load the individual files as a `QImage` into `images[][].image`, allowing for potential future colour change
         Piece::PieceColour player = static_cast<Piece::PieceColour>(i);
-        PieceImageMap &pimp(images[player]);
-        QString filePath = dirPath + "/" + ((player == Piece::White) ? "white_" : "black_");
-        pimp[Piece::Bishop].image.load(filePath + "bishop.png");
-        pimp[Piece::King].image.load(filePath + "king.png");
-        pimp[Piece::Knight].image.load(filePath + "knight.png");
-        pimp[Piece::Pawn].image.load(filePath + "pawn.png");
-        pimp[Piece::Queen].image.load(filePath + "queen.png");
-        pimp[Piece::Rook].image.load(filePath + "rook.png");
+        for (auto it = pieceSet.images[player].cbegin(); it != pieceSet.images[player].cend(); ++it)
+            images[player][it.key()].image = it.value();
 
         // populate the corresponding `images[][].pixmap`, for direct usage
         revertPiecesColour(player);
@@ -39,49 +41,113 @@ PieceImages::~PieceImages()
     images[1].clear();
 }
 
-const QPixmap PieceImages::piecePixmap(Piece::PieceColour colour, Piece::PieceName name) const
+/*static*/ PieceImages::DecodedPieceSet PieceImages::decodedPieceSet(const QString &dirPath)
+{
+    // return the images decoded from the individual files in `dirPath`, decoding them only the first time
+    // a file which cannot be loaded gives a null image, as `QImage::load()` would
+    QMutexLocker locker(&decodedPieceSetsMutex);
+    auto it = decodedPieceSets.constFind(dirPath);
+    if (it != decodedPieceSets.constEnd())
+        return it.value();
+
+    DecodedPieceSet pieceSet;
+    for (int i = 0; i <= 1; i++)
+    {
+        Piece::PieceColour player = static_cast<Piece::PieceColour>(i);
+        DecodedImageMap &dimp(pieceSet.images[player]);
+        QString filePath = dirPath + "/" + ((player == Piece::White) ? "white_" : "black_");
+        dimp[Piece::Bishop].load(filePath + "bishop.png");
+        dimp[Piece::King].load(filePath + "king.png");
+        dimp[Piece::Knight].load(filePath + "knight.png");
+        dimp[Piece::Pawn].load(filePath + "pawn.png");
+        dimp[Piece::Queen].load(filePath + "queen.png");
+        dimp[Piece::Rook].load(filePath + "rook.png");
+    }
+    decodedPieceSets.insert(dirPath, pieceSet);
+    return pieceSet;
+}
+
+/*static*/ QFuture<void> PieceImages::preloadPieceSets(const QStringList &dirPaths)
+{
+    // decode the images of the piece sets in `dirPaths` on a worker thread, so that choosing one later does not wait for it
+    // only `QImage`s are made there, the `QPixmap`s (which must be made on the GUI thread) are made when each set is used
+    return QtConcurrent::run([dirPaths]() {
+        for (const QString &dirPath : dirPaths)
+            decodedPieceSet(dirPath);
+    });
+}
+
+/*static*/ QString PieceImages::pixmapCacheKey(const QString &dirPath, Piece::PieceColour player, Piece::PieceName name, const QColor &colour)
+{
+    // the key in `QPixmapCache` of the pixmap for a piece in a piece set, in its original colour (invalid `colour`) or recoloured
+    return QString("PieceImages:%1:%2:%3:%4").arg(dirPath).arg(player).arg(name).arg(colour.isValid() ? colour.name(QColor::HexArgb) : QString());
+}
+
+void PieceImages::setPixmaps(Piece::PieceColour player)
+{
+    // set `images[player][].pixmap` for the current colour of `player`'s pieces
+    // pixmaps are kept in `QPixmapCache`, so one already made for this piece set and colour is reused rather than made again
+    const QColor &colour(_playerPiecesColour[player]);
+    for (auto it = images[player].begin(); it != images[player].end(); ++it)
+    {
+        QString key(pixmapCacheKey(_dirPath, player, it.key(), colour));
+        if (QPixmapCache::find(key, &it->pixmap))
+            continue;
+        it->pixmap = QPixmap::fromImage(colour.isValid() ? recolouredImage(it->image, player, colour) : it->image);
+        QPixmapCache::insert(key, it->pixmap);
+    }
+}
+
+const QPixmap &PieceImages::piecePixmap(Piece::PieceColour colour, Piece::PieceName name) const
 {
     Q_ASSERT(images[colour].contains(name));
-    return images[colour].value(name).pixmap;
+    return images[colour].find(name)->pixmap;
 }
 
 void PieceImages::revertPiecesColour(Piece::PieceColour player)
 {
     // revert the colour of `player`'s pieces to that in the originally loaded image
     _playerPiecesColour[player] = QColor();
-    for (auto &ip : images[player])
-        ip.pixmap = QPixmap::fromImage(ip.image);
+    setPixmaps(player);
 }
 
 void PieceImages::changePiecesColour(Piece::PieceColour player, const QColor &newColour)
 {
     // change the colour of `player`'s pieces to `newColour`
     _playerPiecesColour[player] = newColour;
-    QColor newColour2(newColour);
-    for (auto &ip : images[player])
-    {
-        QImage image(ip.image);
-        for (int y = 0; y < image.height(); y++)
-            for (int x = 0; x < image.width(); x++)
-            {
-                QRgb rgba(image.pixel(x, y));
-                newColour2.setAlpha(qAlpha(rgba));
-                if (player == Piece::Black && qRed(rgba) + qGreen(rgba) + qBlue(rgba) < 100)    // "darkish"
-                    image.setPixelColor(x, y, newColour2);
-                else if (player == Piece::White && qRed(rgba) + qGreen(rgba) + qBlue(rgba) > 255 * 3 - 100)    // "lightish"
-                    image.setPixelColor(x, y, newColour2);
-            }
-        ip.pixmap = QPixmap::fromImage(image);
-    }
+    setPixmaps(player);
+}
+
+/*static*/ QImage PieceImages::recolouredImage(const QImage &image, Piece::PieceColour player, const QColor &newColour)
+{
+    // return `image` of one of `player`'s pieces with its "darkish" (Black) or "lightish" (White) pixels changed to `newColour`
+    // each pixel keeps its own alpha
+    // the image is converted to (non-premultiplied) ARGB32, the colours `QImage::pixel()` gives, and recoloured a row at a time
+    QImage recoloured(image.convertToFormat(QImage::Format_ARGB32));
+    bool isBlack = (player == Piece::Black);
+    PixelKernels::ReplaceWhich which = isBlack ? PixelKernels::ReplaceBelow : PixelKernels::ReplaceAbove;
+    int threshold = isBlack ? 100 : 255 * 3 - 100;    // "darkish" : "lightish"
+    for (int y = 0; y < recoloured.height(); y++)
+        PixelKernels::replaceColour(reinterpret_cast<quint32 *>(recoloured.scanLine(y)), recoloured.width(), which, threshold, newColour.rgb());
+    return recoloured;
 }
 
 PieceImages::ColourCountMap PieceImages::countColours(const QImage &image) const
 {
     // I wrote this function while looking at changing colours
+    // the colours are counted a run of the same colour at a time
     ColourCountMap colourCount;
-    for (int y = 0; y < image.height(); y++)
-        for (int x = 0; x < image.width(); x++)
-            colourCount[image.pixel(x, y)]++;
+    const QImage argbImage(image.convertToFormat(QImage::Format_ARGB32));
+    for (int y = 0; y < argbImage.height(); y++)
+    {
+        const quint32 *pixels = reinterpret_cast<const quint32 *>(argbImage.constScanLine(y));
+        for (int x = 0, width = argbImage.width(); x < width; )
+        {
+            int run = PixelKernels::runLength(pixels + x, width - x);
+            colourCount[pixels[x]] += run;
+            x += run;
+        }
+    }
     for (const auto key : colourCount.keys())
         if (colourCount.value(key) > 100)
             qDebug() << QString::number(key, 16).toUpper() << QColor(key).name() << colourCount.value(key);
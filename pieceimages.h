@@ -1,10 +1,14 @@
 #ifndef PIECEIMAGES_H
 #define PIECEIMAGES_H
 
+#include <QFuture>
+#include <QHash>
 #include <QImage>
-#include <QPixmap>
 #include <QMap>
+#include <QMutex>
+#include <QPixmap>
 #include <QString>
+#include <QStringList>
 
 #include "piece.h"
 
@@ -16,13 +20,16 @@ public:
     ~PieceImages();
 
     inline const QString &pieceSetName() const { return _pieceSetName; }
-    const QPixmap piecePixmap(Piece::PieceColour colour, Piece::PieceName name) const;
+    const QPixmap &piecePixmap(Piece::PieceColour colour, Piece::PieceName name) const;
     bool foundImages() const { return !piecePixmap(Piece::White, Piece::King).isNull(); }
     const QColor &piecesColour(Piece::PieceColour player) const { return _playerPiecesColour[player]; }
     void revertPiecesColour(Piece::PieceColour player);
     void changePiecesColour(Piece::PieceColour player, const QColor &newColour);
 
+    static QFuture<void> preloadPieceSets(const QStringList &dirPaths);
+
 private:
+    QString _dirPath;
     QString _pieceSetName;
     QColor _playerPiecesColour[2];
     struct ImageAndPixmap
@@ -32,6 +39,22 @@ private:
     };
     typedef QMap<Piece::PieceName, ImageAndPixmap> PieceImageMap;
     PieceImageMap images[2];
+    void setPixmaps(Piece::PieceColour player);
+    static QString pixmapCacheKey(const QString &dirPath, Piece::PieceColour player, Piece::PieceName name, const QColor &colour);
+    static QImage recolouredImage(const QImage &image, Piece::PieceColour player, const QColor &newColour);
+
+    // the images decoded from each piece set directory, shared by every `PieceImages` for that directory
+    // so that switching back to a piece set does not decode its files again
+    // they may be decoded on a worker thread by `preloadPieceSets()`, hence the mutex
+    typedef QMap<Piece::PieceName, QImage> DecodedImageMap;
+    struct DecodedPieceSet
+    {
+        DecodedImageMap images[2];
+    };
+    static QMutex decodedPieceSetsMutex;
+    static QHash<QString, DecodedPieceSet> decodedPieceSets;
+    static DecodedPieceSet decodedPieceSet(const QString &dirPath);
+
     typedef QMap<QRgb, int> ColourCountMap;
     ColourCountMap countColours(const QImage &image) const;
     void produceFilesFromCombinedFile(const QString &dirPath);
@@ -0,0 +1,111 @@
+#include "pixelkernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIXELKERNELS_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(PIXELKERNELS_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define PIXELKERNELS_AVX2
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+inline bool shouldReplace(quint32 pixel, PixelKernels::ReplaceWhich which, int threshold)
+{
+    int sum = ((pixel >> 16) & 0xFF) + ((pixel >> 8) & 0xFF) + (pixel & 0xFF);
+    return (which == PixelKernels::ReplaceBelow) ? sum < threshold : sum > threshold;
+}
+
+int replaceColourScalar(quint32 *pixels, int count, PixelKernels::ReplaceWhich which, int threshold, quint32 rgb)
+{
+    for (int i = 0; i < count; i++)
+        if (shouldReplace(pixels[i], which, threshold))
+            pixels[i] = (pixels[i] & 0xFF000000) | rgb;
+    return count;
+}
+
+#ifdef PIXELKERNELS_SSE2
+int replaceColourSse2(quint32 *pixels, int count, PixelKernels::ReplaceWhich which, int threshold, quint32 rgb)
+{
+    // returns how many pixels it did, a multiple of 4, the rest are left to the scalar kernel
+    const __m128i byteMask = _mm_set1_epi32(0xFF), alphaMask = _mm_set1_epi32(int(0xFF000000));
+    const __m128i thresholds = _mm_set1_epi32(threshold), rgbs = _mm_set1_epi32(int(rgb));
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+        __m128i sum = _mm_add_epi32(_mm_add_epi32(_mm_and_si128(_mm_srli_epi32(p, 16), byteMask),
+                                                  _mm_and_si128(_mm_srli_epi32(p, 8), byteMask)),
+                                    _mm_and_si128(p, byteMask));
+        __m128i replace = (which == PixelKernels::ReplaceBelow) ? _mm_cmplt_epi32(sum, thresholds) : _mm_cmpgt_epi32(sum, thresholds);
+        __m128i replaced = _mm_or_si128(_mm_and_si128(p, alphaMask), rgbs);
+        p = _mm_or_si128(_mm_and_si128(replace, replaced), _mm_andnot_si128(replace, p));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i), p);
+    }
+    return i;
+}
+#endif
+
+#ifdef PIXELKERNELS_AVX2
+__attribute__((target("avx2")))
+int replaceColourAvx2(quint32 *pixels, int count, PixelKernels::ReplaceWhich which, int threshold, quint32 rgb)
+{
+    // returns how many pixels it did, a multiple of 8, the rest are left to the other kernels
+    const __m256i byteMask = _mm256_set1_epi32(0xFF), alphaMask = _mm256_set1_epi32(int(0xFF000000));
+    const __m256i thresholds = _mm256_set1_epi32(threshold), rgbs = _mm256_set1_epi32(int(rgb));
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pixels + i));
+        __m256i sum = _mm256_add_epi32(_mm256_add_epi32(_mm256_and_si256(_mm256_srli_epi32(p, 16), byteMask),
+                                                        _mm256_and_si256(_mm256_srli_epi32(p, 8), byteMask)),
+                                       _mm256_and_si256(p, byteMask));
+        __m256i replace = (which == PixelKernels::ReplaceBelow) ? _mm256_cmpgt_epi32(thresholds, sum) : _mm256_cmpgt_epi32(sum, thresholds);
+        __m256i replaced = _mm256_or_si256(_mm256_and_si256(p, alphaMask), rgbs);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(pixels + i), _mm256_blendv_epi8(p, replaced, replace));
+    }
+    return i;
+}
+
+bool hasAvx2()
+{
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+#endif
+
+}
+
+void PixelKernels::replaceColour(quint32 *pixels, int count, ReplaceWhich which, int threshold, quint32 rgb)
+{
+    // the widest kernel available does as many pixels as it can, narrower ones the remainder
+    rgb &= 0x00FFFFFF;
+    int done = 0;
+#ifdef PIXELKERNELS_AVX2
+    if (hasAvx2())
+        done += replaceColourAvx2(pixels, count, which, threshold, rgb);
+#endif
+#ifdef PIXELKERNELS_SSE2
+    done += replaceColourSse2(pixels + done, count - done, which, threshold, rgb);
+#endif
+    replaceColourScalar(pixels + done, count - done, which, threshold, rgb);
+}
+
+int PixelKernels::runLength(const quint32 *pixels, int count)
+{
+    // the images are mostly long runs of one colour (e.g. the transparent background), so this compares 4 pixels at a time
+    Q_ASSERT(count > 0);
+    const quint32 first = pixels[0];
+    int i = 1;
+#ifdef PIXELKERNELS_SSE2
+    const __m128i firsts = _mm_set1_epi32(int(first));
+    for (; i + 4 <= count; i += 4)
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i)), firsts)) != 0xFFFF)
+            break;
+#endif
+    while (i < count && pixels[i] == first)
+        i++;
+    return i;
+}
@@ -0,0 +1,21 @@
+#ifndef PIXELKERNELS_H
+#define PIXELKERNELS_H
+
+#include <QtGlobal>
+
+// kernels working directly on rows of 32-bit ARGB pixels (`QImage::Format_ARGB32`, as from `QImage::scanLine()`)
+// on x86 they process 8 (AVX2, where the CPU has it) or 4 (SSE2) pixels at a time, elsewhere one at a time
+namespace PixelKernels
+{
+    // which pixels `replaceColour()` replaces, by the sum of their red, green and blue against `threshold`
+    enum ReplaceWhich { ReplaceBelow, ReplaceAbove };
+
+    // replace the colour of each of the `count` pixels whose red + green + blue is below/above `threshold` with `rgb`,
+    // keeping the pixel's alpha
+    void replaceColour(quint32 *pixels, int count, ReplaceWhich which, int threshold, quint32 rgb);
+
+    // return how many pixels, starting from `pixels[0]`, are the same as `pixels[0]` (at least 1)
+    int runLength(const quint32 *pixels, int count);
+}
+
+#endif // PIXELKERNELS_H
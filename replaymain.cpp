@@ -0,0 +1,88 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include "batchreplayer.h"
+#include "gameindex.h"
+#include "gamereplayer.h"
+
+int main(int argc, char *argv[])
+{
+    // console program to replay/validate game files without any GUI
+    // usage: chessreplay [-j threads] [-c cache-entries] <file-or-directory>...
+    // each game in each file is replayed, a directory means every file in it
+    // games are replayed in parallel, on `threads` worker threads (default one per core)
+    // with `-c` each worker thread caches up to `cache-entries` resolved moves, so moves shared by games are resolved once
+    // prints one line per game, and the throughput to stderr, exit status is the number of games which failed (capped at 125), or 255 for a usage error
+    QCoreApplication a(argc, argv);
+    QTextStream out(stdout), err(stderr);
+
+    QStringList args = QCoreApplication::arguments().mid(1);
+    int threadCount = 0;
+    int threadCountIndex = args.indexOf("-j");
+    if (threadCountIndex >= 0 && threadCountIndex + 1 < args.count())
+    {
+        threadCount = qMax(1, args.at(threadCountIndex + 1).toInt());
+        args.removeAt(threadCountIndex + 1);
+        args.removeAt(threadCountIndex);
+    }
+    int cacheSize = 0;
+    int cacheSizeIndex = args.indexOf("-c");
+    if (cacheSizeIndex >= 0 && cacheSizeIndex + 1 < args.count())
+    {
+        cacheSize = qMax(0, args.at(cacheSizeIndex + 1).toInt());
+        args.removeAt(cacheSizeIndex + 1);
+        args.removeAt(cacheSizeIndex);
+    }
+    if (args.isEmpty())
+    {
+        err << "Usage: chessreplay [-j threads] [-c cache-entries] <file-or-directory>..." << Qt::endl;
+        return 255;
+    }
+
+    // expand any directories into the files they contain
+    QStringList filePaths = GameIndex::expandFilePaths(args);
+
+    // find all the games, a file holding many games is indexed so that each game can be read from its position in the file
+    // then replay them all in parallel, and report success or where each failed in the order they were found
+    QElapsedTimer timer;
+    timer.start();
+    QList<BatchReplayer::Game> games = BatchReplayer::indexGames(filePaths);
+    BatchReplayer batchReplayer(threadCount);
+    batchReplayer.setMoveParseCacheSize(cacheSize);
+    MoveParseCache::Stats cacheStats;
+    QVector<GameReplayer::Result> results = batchReplayer.replay(games, &cacheStats);
+    qint64 elapsed = timer.elapsed();
+
+    int failed = 0, movesMade = 0;
+    for (int i = 0; i < games.count(); i++)
+    {
+        const BatchReplayer::Game &game(games.at(i));
+        const GameReplayer::Result &result(results.at(i));
+        QString gameName = (game.gameNumber > 0) ? QString("%1 [game %2]").arg(game.filePath).arg(game.gameNumber) : game.filePath;
+        movesMade += result.movesMade;
+        if (result.success)
+            out << gameName << ": OK (" << result.movesMade << " moves)" << Qt::endl;
+        else
+        {
+            failed++;
+            if (result.failedTokenIndex < 0)
+                out << gameName << ": FAILED: " << result.message << Qt::endl;
+            else
+                out << gameName << ": FAILED at move " << result.failedTokenIndex / 2 + 1 << ((result.failedTokenIndex % 2 == 0) ? "" : "...")
+                    << " \"" << result.failedToken << "\": " << result.message << Qt::endl;
+        }
+    }
+    out << games.count() - failed << " of " << games.count() << " games replayed successfully" << Qt::endl;
+    double seconds = qMax(elapsed, qint64(1)) / 1000.0;
+    err << QString("%1 games, %2 moves in %3 s using %4 threads: %5 games/s")
+           .arg(games.count()).arg(movesMade).arg(seconds, 0, 'f', 3).arg(batchReplayer.threadCount()).arg(games.count() / seconds, 0, 'f', 1) << Qt::endl;
+    if (cacheSize > 0)
+    {
+        qint64 lookups = qMax(cacheStats.hits + cacheStats.misses, qint64(1));
+        err << QString("move parse cache: %1 hits, %2 misses (%3% hit rate)")
+               .arg(cacheStats.hits).arg(cacheStats.misses).arg(cacheStats.hits * 100.0 / lookups, 0, 'f', 1) << Qt::endl;
+    }
+
+    return qMin(failed, 125);
+}
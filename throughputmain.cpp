@@ -0,0 +1,304 @@
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "boardmodel.h"
+#include "gameindex.h"
+#include "gamereplayer.h"
+#include "moveparsecache.h"
+
+// heap allocations made by the program are counted, so that allocations per move can be reported
+static std::atomic<qint64> allocationCount(0);
+
+#if defined(Q_OS_LINUX) && defined(__GLIBC__)
+// on glibc the C allocation functions are interposed, `malloc()`, `calloc()`, `realloc()` and the aligned
+// `posix_memalign()`, `aligned_alloc()` & `memalign()`, so that allocations by Qt's containers (which call `malloc()`/`realloc()` directly)
+// are counted as well as those by `operator new` (which calls `malloc()`, or `aligned_alloc()` for over-aligned types)
+// and the count is reported as "allocationsPerMove" (only the obsolete `valloc()`/`pvalloc()` are not counted)
+static constexpr bool allocationsCountedAtMalloc = true;
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *p);
+
+void *malloc(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *p, size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **p, size_t alignment, size_t size)
+{
+    // `posix_memalign()` requires the alignment to be a power of two multiple of `sizeof(void *)`, and reports failure by its result
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void *allocated = __libc_memalign(alignment, size);
+    if (!allocated)
+        return ENOMEM;
+    *p = allocated;
+    return 0;
+}
+
+void free(void *p)
+{
+    __libc_free(p);
+}
+}
+#else
+// elsewhere only `operator new` is counted, which misses Qt's containers' own allocations,
+// so the count is reported as "operatorNewPerMove" rather than passed off as all allocations
+static constexpr bool allocationsCountedAtMalloc = false;
+
+void *operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+#endif
+
+static qint64 peakRssKiB()
+{
+    // return the peak resident set size of the process so far in KiB, -1 => not known on this platform
+#ifdef Q_OS_UNIX
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+#ifdef Q_OS_MACOS
+    return usage.ru_maxrss / 1024;     // bytes
+#else
+    return usage.ru_maxrss;            // KiB
+#endif
+#else
+    return -1;
+#endif
+}
+
+static qint64 currentRssKiB()
+{
+    // return the current resident set size of the process in KiB, -1 => not known on this platform
+#ifdef Q_OS_LINUX
+    // the second field of /proc/self/statm is the resident size in pages
+    qint64 size, resident;
+    FILE *statm = std::fopen("/proc/self/statm", "r");
+    if (!statm)
+        return -1;
+    int fields = std::fscanf(statm, "%lld %lld", &size, &resident);
+    std::fclose(statm);
+    if (fields != 2)
+        return -1;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+#else
+    return -1;
+#endif
+}
+
+struct GameTokens
+{
+    QString name;
+    QStringList tokens;
+};
+
+static bool readGames(const QStringList &args, QList<GameTokens> &games, QTextStream &err)
+{
+    // read every game in the files/directories in `args` into `games`, a directory meaning every file in it
+    for (const QString &filePath : GameIndex::expandFilePaths(args))
+    {
+        GameIndex gameIndex;
+        QString errorMessage;
+        QFile file(filePath);
+        if (!gameIndex.open(filePath, &errorMessage) || !file.open(QIODevice::ReadOnly))
+        {
+            err << filePath << ": " << (errorMessage.isEmpty() ? file.errorString() : errorMessage) << Qt::endl;
+            return false;
+        }
+        for (int i = 0; i < gameIndex.count(); i++)
+        {
+            file.seek(gameIndex.at(i).pos);
+            QString name = (gameIndex.count() > 1) ? QString("%1 [game %2]").arg(filePath).arg(i + 1) : filePath;
+            games.append({ name, GameReplayer::readTokens(&file, gameIndex.at(i).endPos) });
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    // console program to benchmark whole-game replay throughput through the board model
+    // usage: chessthroughput [-s scale]... [-c cache-entries] [file-or-directory]...
+    // with no files the `samplegames` directory is used
+    // each game is replayed from a new game by `BoardModel::parseAndMakeMove()`, exactly as the GUI makes moves but without any GUI,
+    // so a game which fails (e.g. `badgame`) is timed through the parser's error path
+    // the games are replayed once as read, then as a synthetic corpus of the games repeated `scale` times for each `-s` given
+    // (default 10 and 100)
+    // prints one JSON object per corpus to stdout, for tracking across releases, then one with the peak RSS of the whole run,
+    // and a readable summary to stderr
+    QCoreApplication a(argc, argv);
+    QTextStream out(stdout), err(stderr);
+
+    QStringList args = QCoreApplication::arguments().mid(1);
+    QList<int> scales;
+    for (int index; (index = args.indexOf("-s")) >= 0 && index + 1 < args.count(); )
+    {
+        scales << qMax(1, args.at(index + 1).toInt());
+        args.removeAt(index + 1);
+        args.removeAt(index);
+    }
+    if (scales.isEmpty())
+        scales << 10 << 100;
+    scales.prepend(1);
+    int cacheSize = 0;
+    int cacheSizeIndex = args.indexOf("-c");
+    if (cacheSizeIndex >= 0 && cacheSizeIndex + 1 < args.count())
+    {
+        cacheSize = qMax(0, args.at(cacheSizeIndex + 1).toInt());
+        args.removeAt(cacheSizeIndex + 1);
+        args.removeAt(cacheSizeIndex);
+    }
+    if (args.isEmpty())
+        args << "samplegames";
+
+    QList<GameTokens> games;
+    if (!readGames(args, games, err))
+        return 1;
+    if (games.isEmpty())
+    {
+        err << "Usage: chessthroughput [-s scale]... [-c cache-entries] [file-or-directory]..." << Qt::endl;
+        return 1;
+    }
+
+    BoardModel boardModel;
+    MoveParseCache moveParseCache(qMax(cacheSize, 1));
+    if (cacheSize > 0)
+        boardModel.setMoveParseCache(&moveParseCache);
+    // one untimed replay of everything first, so that one-time setup costs are not counted against the first corpus
+    for (const GameTokens &game : games)
+    {
+        boardModel.newGame();
+        Piece::PieceColour player = Piece::White;
+        for (const QString &token : game.tokens)
+        {
+            if (!boardModel.parseAndMakeMove(player, token))
+                break;
+            player = Piece::opposingColour(player);
+        }
+    }
+
+    for (int scale : scales)
+    {
+        moveParseCache.clear();
+        moveParseCache.resetStats();
+        qint64 gameCount = 0, failedGames = 0, moves = 0, failedMoves = 0;
+        qint64 rssBefore = currentRssKiB();
+        qint64 allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+        QElapsedTimer timer;
+        timer.start();
+        for (int r = 0; r < scale; r++)
+            for (const GameTokens &game : games)
+            {
+                boardModel.newGame();
+                Piece::PieceColour player = Piece::White;
+                gameCount++;
+                for (const QString &token : game.tokens)
+                {
+                    if (!boardModel.parseAndMakeMove(player, token))
+                    {
+                        failedGames++;
+                        failedMoves++;
+                        break;
+                    }
+                    moves++;
+                    player = Piece::opposingColour(player);
+                }
+            }
+        qint64 nsecs = qMax(timer.nsecsElapsed(), qint64(1));
+        qint64 allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+        qint64 rssAfter = currentRssKiB();
+        qint64 rssGrowth = (rssBefore >= 0 && rssAfter >= 0) ? rssAfter - rssBefore : -1;
+        double seconds = nsecs / 1e9;
+        qint64 movesAttempted = moves + failedMoves;
+        double allocationsPerMove = double(allocations) / qMax(movesAttempted, qint64(1));
+
+        QJsonObject result;
+        result["corpus"] = QString("x%1").arg(scale);
+        result["games"] = gameCount;
+        result["failedGames"] = failedGames;
+        result["moves"] = moves;
+        result["seconds"] = seconds;
+        result["movesPerSecond"] = moves / seconds;
+        result["gamesPerSecond"] = gameCount / seconds;
+        result["nsPerMove"] = double(nsecs) / qMax(movesAttempted, qint64(1));
+        result[allocationsCountedAtMalloc ? "allocationsPerMove" : "operatorNewPerMove"] = allocationsPerMove;
+        result["rssGrowthKiB"] = rssGrowth;
+        if (cacheSize > 0)
+        {
+            result["cacheHits"] = moveParseCache.stats().hits;
+            result["cacheMisses"] = moveParseCache.stats().misses;
+        }
+        out << QJsonDocument(result).toJson(QJsonDocument::Compact) << Qt::endl;
+        err << QString("x%1: %2 games (%3 failed), %4 moves in %5 s: %6 moves/s, %7 games/s, %8 %9/move, RSS growth %10 KiB")
+               .arg(scale).arg(gameCount).arg(failedGames).arg(moves).arg(seconds, 0, 'f', 3)
+               .arg(moves / seconds, 0, 'f', 0).arg(gameCount / seconds, 0, 'f', 1)
+               .arg(allocationsPerMove, 0, 'f', 1).arg(allocationsCountedAtMalloc ? "allocations" : "operator new calls").arg(rssGrowth) << Qt::endl;
+    }
+    // the peak RSS is a high-water mark for the whole process, including the warm-up replay and every corpus, so it is reported just once
+    QJsonObject summary;
+    summary["peakRssKiB"] = peakRssKiB();
+    out << QJsonDocument(summary).toJson(QJsonDocument::Compact) << Qt::endl;
+    err << QString("peak RSS %1 KiB").arg(peakRssKiB()) << Qt::endl;
+
+    return 0;
+}
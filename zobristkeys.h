@@ -0,0 +1,42 @@
+#ifndef ZOBRISTKEYS_H
+#define ZOBRISTKEYS_H
+
+#include <QtGlobal>
+
+// random keys for Zobrist hashing of positions, generated at compile time
+// a position's key is the XOR of the key of each piece on its square, and `blackToMove` if it is Black to move
+// so adding, removing or moving a piece updates the key with one or two XORs
+// squares are numbered 0..63, `row * 8 + col`, as in `BoardPosition`
+struct ZobristKeys
+{
+    typedef quint64 Key;
+
+    // indexed by `Piece::PieceColour`, `Piece::PieceName`, square
+    Key pieceSquare[2][6][64];
+    Key blackToMove;
+
+    constexpr ZobristKeys() :
+        pieceSquare{}, blackToMove(0)
+    {
+        // the keys are a fixed splitmix64 sequence, so they (and hence position keys) are the same from run to run
+        quint64 state = 0x9E3779B97F4A7C15;
+        for (auto &colourKeys : pieceSquare)
+            for (auto &nameKeys : colourKeys)
+                for (Key &key : nameKeys)
+                    key = next(state);
+        blackToMove = next(state);
+    }
+
+private:
+    static constexpr quint64 next(quint64 &state)
+    {
+        quint64 z = (state += 0x9E3779B97F4A7C15);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+        return z ^ (z >> 31);
+    }
+};
+
+inline constexpr ZobristKeys zobristKeys;
+
+#endif // ZOBRISTKEYS_H